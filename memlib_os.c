@@ -0,0 +1,759 @@
+/*
+ * memlib_os.c - memlib on top of the operating system.
+ *
+ * The lab's memlib simulates the heap inside a malloc'ed array, which only
+ * works under the trace driver. This version reserves a window of address
+ * space with mmap and moves the break inside it, committing pages as the
+ * break grows and handing them back to the OS when it shrinks. Memory
+ * returned by mem_sbrk has never been written, so it reads as zero.
+ *
+ * mm.c links free blocks through 4 byte offsets from mem_heap_lo(), so the
+ * window is at most 4 GB.
+ *
+ * Built with -DMM_PERSIST and with MM_HEAP_FILE set in the environment, the
+ * window is a shared mapping of that file instead, so the heap outlives the
+ * process. The file starts with a page recording where the heap was mapped
+ * and where the break is. A later run maps it at the same address, which
+ * keeps the application's own pointers into the heap valid, and mm_init
+ * picks up the heap it finds there.
+ *
+ * Built with -DMM_SHARED, the heap can also be the POSIX shared memory
+ * object named by MM_SHM_NAME, and several processes can attach to the
+ * same file or object at once. The break then lives only in the first
+ * page, next to a process-shared lock that callers take around every
+ * allocator call with mem_lock/mem_unlock (see mm_shared.c).
+ *
+ * Built with -DMM_HUGEPAGES, the anonymous window is aligned to 2 MB and
+ * committed and purged in whole 2 MB pages. Each span is mapped from the
+ * hugetlb pool with MAP_HUGETLB while it has pages, otherwise as ordinary
+ * memory marked MADV_HUGEPAGE for transparent huge pages.
+ *
+ * Built with -DMM_NUMA, there is one window per NUMA node, each with its
+ * own break and with an mbind policy preferring that node. mem_select
+ * switches between them; the window of mem_init belongs to node 0.
+ *
+ * Built with -DMM_SEGMENTS, mem_map hands out separate page aligned spans
+ * from the top of the window downward, for mm.c's heap segments, and
+ * mem_unmap takes them back. The break cannot grow into them.
+ *
+ * Built with -DMM_LARGE, mem_map_large maps memory outside the window for
+ * mm.c's large blocks, which may be larger than the window itself.
+ *
+ * Built with -DMM_FREE_CHECK, each window has a shadow of one bit for every
+ * 8 bytes, for mm.c's bitmap of allocated blocks. It is private to the
+ * process, so the shared heap cannot have one.
+ *
+ * Built with -DMM_BIN_INDEX, each window also has the side memory mm.c
+ * keeps its free list index in, private to the process as well. It is
+ * reserved whole and only the pages the index reaches are committed.
+ */
+#ifdef MM_LARGE
+#define _GNU_SOURCE             /* mremap */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef MM_NUMA
+#include <sys/syscall.h>
+#endif
+#ifdef MM_SHARED
+#include <pthread.h>
+#include <sys/file.h>
+#endif
+
+#include "memlib.h"
+
+#if defined(MM_SEGMENTS) && (defined(MM_PERSIST) || defined(MM_SHARED) || defined(MM_NUMA))
+#error "MM_SEGMENTS needs the single anonymous window"
+#endif
+#if defined(MM_LARGE) && (defined(MM_PERSIST) || defined(MM_SHARED))
+#error "MM_LARGE blocks are not part of the heap file"
+#endif
+#if defined(MM_FREE_CHECK) && defined(MM_SHARED)
+#error "MM_FREE_CHECK keeps its bitmap in the process"
+#endif
+#if defined(MM_BIN_INDEX) && defined(MM_SHARED)
+#error "MM_BIN_INDEX keeps its index in the process"
+#endif
+
+#if UINTPTR_MAX > 0xffffffffUL
+#define MAX_HEAP   ((size_t)1 << 32)   /* whole range of a 4 byte offset */
+#else
+#define MAX_HEAP   ((size_t)1 << 30)
+#endif
+#ifdef MM_HUGEPAGES
+#define HUGE_PAGE   ((size_t)1 << 21)
+#define COMMIT_STEP HUGE_PAGE          /* commit and purge whole huge pages */
+#else
+#define COMMIT_STEP ((size_t)1 << 16)  /* commit in 64 KB steps */
+#endif
+
+#ifdef MM_NUMA
+#define MEM_MAX_NODES  8
+#define MPOL_PREFERRED 1               /* from numaif.h, which needs libnuma */
+
+/* Windows of the nodes, the selected one is also in the variables below */
+static struct {
+  char *start, *brk, *commit;
+  char *shadow;
+  char *index;
+} mem_nodes[MEM_MAX_NODES];
+static int mem_node;                   /* selected node */
+#endif
+
+#ifdef MM_SEGMENTS
+#define MEM_MAX_SPANS 256
+
+/* Spans given back by mem_unmap below mem_map_lo, for reuse */
+static struct {
+  char *lo;
+  size_t size;
+} mem_spans[MEM_MAX_SPANS];
+static int mem_nspans;
+static char *mem_map_lo;     /* lowest span handed out by mem_map */
+#endif
+
+/* private variables */
+static char *mem_start_brk;  /* points to first byte of heap */
+static char *mem_brk;        /* points to last byte of heap plus one */
+static char *mem_commit;     /* end of the read/write part of the window */
+static char *mem_max_addr;   /* largest legal heap address */
+#ifdef MM_FREE_CHECK
+static char *mem_shadow_map; /* see mem_shadow, NULL until first asked for */
+#endif
+#ifdef MM_BIN_INDEX
+static char *mem_index_map;  /* see mem_index, NULL until first asked for */
+#endif
+
+#if defined(MM_SHARED) && !defined(MM_PERSIST)
+#define MM_PERSIST
+#endif
+
+#ifdef MM_PERSIST
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0   /* the address is still checked below */
+#endif
+#define FILE_MAGIC   0x46484d4d  /* "MMHF" */
+#define FILE_VERSION 2
+#define ATTACH_TRIES 1000        /* ms to wait for the creator of the file */
+
+/* First page of the heap file, the heap follows it */
+typedef struct {
+  unsigned int magic;
+  unsigned int version;
+  char *start;                /* where the heap was mapped */
+  size_t brk;                 /* bytes below the break */
+  size_t commit;              /* bytes of the heap in the file */
+#ifdef MM_SHARED
+  pthread_mutex_t lock;       /* held around allocator calls */
+#endif
+} file_hdr_t;
+
+static int mem_fd = -1;
+static file_hdr_t *mem_hdr;
+
+static void mem_init_file(int fd, const char *path, int created);
+
+#ifdef MM_SHARED
+/* Another process may have moved the break */
+#define SYNC_BRK() do { if (mem_fd >= 0) { mem_brk = mem_start_brk + mem_hdr->brk; \
+                                           mem_commit = mem_start_brk + mem_hdr->commit; } } while (0)
+#endif
+#endif
+
+#ifndef SYNC_BRK
+#define SYNC_BRK()
+#endif
+
+/*
+ * reserve_window - reserve MAX_HEAP bytes of address space, NULL if none left
+ */
+static char *reserve_window(void)
+{
+  void *p;
+
+#ifdef MM_HUGEPAGES
+  /* Reserve a huge page more and cut the window out of it on a huge page boundary */
+  p = mmap(NULL, MAX_HEAP + HUGE_PAGE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p != MAP_FAILED) {
+    char *lo = (char *)(((uintptr_t)p + HUGE_PAGE - 1) & ~(uintptr_t)(HUGE_PAGE - 1));
+
+    if (lo > (char *)p)
+      munmap(p, lo - (char *)p);
+    munmap(lo + MAX_HEAP, (char *)p + HUGE_PAGE - lo);
+    p = lo;
+  }
+#else
+  p = mmap(NULL, MAX_HEAP, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+#endif
+  return p == MAP_FAILED ? NULL : p;
+}
+
+#ifdef MM_NUMA
+/*
+ * bind_node - have the pages of window p come from node when possible.
+ *     Fails quietly for nodes the machine does not have, which is how a
+ *     simulated topology runs on a single node.
+ */
+static void bind_node(char *p, int node)
+{
+  unsigned long mask = 1UL << node;
+
+  syscall(SYS_mbind, p, MAX_HEAP, MPOL_PREFERRED, &mask, sizeof(mask) * 8, 0);
+}
+#endif
+
+/*
+ * mem_init - reserve the heap window, nothing is committed yet
+ */
+void mem_init(void)
+{
+  char *p;
+
+#ifdef MM_PERSIST
+  char *path = getenv("MM_HEAP_FILE");
+  int fd;
+
+#ifdef MM_SHARED
+  if (getenv("MM_SHM_NAME") != NULL) {
+    path = getenv("MM_SHM_NAME");
+    if ((fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0600)) >= 0 || errno != EEXIST)
+      mem_init_file(fd, path, 1);
+    else
+      mem_init_file(shm_open(path, O_RDWR, 0), path, 0);
+    return;
+  }
+#endif
+  if (path != NULL) {
+    if ((fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600)) >= 0 || errno != EEXIST)
+      mem_init_file(fd, path, 1);
+    else
+      mem_init_file(open(path, O_RDWR), path, 0);
+    return;
+  }
+#endif
+
+  if ((p = reserve_window()) == NULL) {
+    perror("mem_init: mmap");
+    exit(1);
+  }
+  mem_start_brk = p;
+  mem_brk = mem_start_brk;
+  mem_commit = mem_start_brk;
+  mem_max_addr = mem_start_brk + MAX_HEAP;
+#ifdef MM_SEGMENTS
+  mem_map_lo = mem_max_addr;
+  mem_nspans = 0;
+#endif
+#ifdef MM_NUMA
+  bind_node(p, 0);
+  mem_node = 0;
+#endif
+}
+
+#ifdef MM_NUMA
+/*
+ * mem_select - make the window of node the current heap.
+ *     The window is reserved on first use. Returns 1 if it is new, so the
+ *     caller has to build a heap in it, 0 if not, -1 if it cannot be had.
+ */
+int mem_select(int node)
+{
+  int fresh = 0;
+  char *p;
+
+  if (node < 0 || node >= MEM_MAX_NODES)
+    return -1;
+  if (node == mem_node)
+    return 0;
+
+  if (mem_nodes[node].start == NULL) {
+    if ((p = reserve_window()) == NULL)
+      return -1;
+    bind_node(p, node);
+    mem_nodes[node].start = mem_nodes[node].brk = mem_nodes[node].commit = p;
+    fresh = 1;
+  }
+
+  mem_nodes[mem_node].start = mem_start_brk;
+  mem_nodes[mem_node].brk = mem_brk;
+  mem_nodes[mem_node].commit = mem_commit;
+#ifdef MM_FREE_CHECK
+  mem_nodes[mem_node].shadow = mem_shadow_map;
+  mem_shadow_map = mem_nodes[node].shadow;
+#endif
+#ifdef MM_BIN_INDEX
+  mem_nodes[mem_node].index = mem_index_map;
+  mem_index_map = mem_nodes[node].index;
+#endif
+  mem_node = node;
+  mem_start_brk = mem_nodes[node].start;
+  mem_brk = mem_nodes[node].brk;
+  mem_commit = mem_nodes[node].commit;
+  mem_max_addr = mem_start_brk + MAX_HEAP;
+  return fresh;
+}
+
+/*
+ * mem_node_of - node whose window holds ptr, -1 if none does
+ */
+int mem_node_of(void *ptr)
+{
+  int i;
+
+  if ((char *)ptr >= mem_start_brk && (char *)ptr < mem_max_addr)
+    return mem_node;
+  for (i = 0; i < MEM_MAX_NODES; i++)
+    if (mem_nodes[i].start != NULL && (char *)ptr >= mem_nodes[i].start &&
+        (char *)ptr < mem_nodes[i].start + MAX_HEAP)
+      return i;
+  return -1;
+}
+#endif
+
+#ifdef MM_PERSIST
+/*
+ * mem_init_file - map the heap file fd, which was just created if created.
+ *     An existing heap goes back to the address it was created at.
+ */
+static void mem_init_file(int fd, const char *path, int created)
+{
+  size_t pagesize = mem_pagesize();
+  file_hdr_t hdr;
+  char *hint = NULL;
+  void *p;
+  int tries;
+
+  if ((mem_fd = fd) < 0) {
+    perror(path);
+    exit(1);
+  }
+
+  if (!created) {
+    /* The magic is written last, once the creator has set the file up */
+    for (tries = 0; pread(mem_fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) || hdr.magic != FILE_MAGIC; tries++) {
+      if (tries == ATTACH_TRIES) {
+        fprintf(stderr, "mem_init: %s is not a heap file\n", path);
+        exit(1);
+      }
+      usleep(1000);
+    }
+    if (hdr.version != FILE_VERSION) {
+      fprintf(stderr, "mem_init: %s is a heap file of another version\n", path);
+      exit(1);
+    }
+    hint = hdr.start - pagesize;
+  }
+  else if (ftruncate(mem_fd, pagesize) < 0) {
+    perror(path);
+    exit(1);
+  }
+
+  p = mmap(hint, pagesize + MAX_HEAP, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_NORESERVE | (hint ? MAP_FIXED_NOREPLACE : 0), mem_fd, 0);
+  if (p == MAP_FAILED || (hint && p != hint)) {
+    fprintf(stderr, "mem_init: cannot map %s at %p\n", path, (void *)hint);
+    exit(1);
+  }
+
+  mem_hdr = p;
+  mem_start_brk = (char *)p + pagesize;
+  if (created) {
+#ifdef MM_SHARED
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&mem_hdr->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+#endif
+    mem_hdr->version = FILE_VERSION;
+    mem_hdr->start = mem_start_brk;
+    mem_hdr->brk = 0;
+    mem_hdr->commit = 0;
+    __atomic_store_n(&mem_hdr->magic, FILE_MAGIC, __ATOMIC_RELEASE);
+  }
+  mem_brk = mem_start_brk + mem_hdr->brk;
+  mem_commit = mem_start_brk + mem_hdr->commit;
+  mem_max_addr = mem_start_brk + MAX_HEAP;
+}
+#endif
+
+#ifdef MM_SHARED
+/*
+ * mem_lock - take the lock of a shared heap.
+ *     A process that died holding it leaves whatever it was doing
+ *     half done, the lock is taken over regardless.
+ */
+void mem_lock(void)
+{
+  if (mem_hdr != NULL && pthread_mutex_lock(&mem_hdr->lock) == EOWNERDEAD)
+    pthread_mutex_consistent(&mem_hdr->lock);
+}
+
+void mem_unlock(void)
+{
+  if (mem_hdr != NULL)
+    pthread_mutex_unlock(&mem_hdr->lock);
+}
+#endif
+
+#ifdef MM_PERSIST
+/*
+ * mem_others - whether other processes use the heap as well, called by
+ *     mm_init with the heap locked. Each process that has asked holds a
+ *     shared flock on the file until it exits or dies, so the lock is only
+ *     had alone when no other process is attached.
+ */
+int mem_others(void)
+{
+#ifdef MM_SHARED
+  int others;
+
+  if (mem_fd < 0)
+    return 0;
+  others = flock(mem_fd, LOCK_EX | LOCK_NB) != 0;
+  flock(mem_fd, LOCK_SH);
+  return others;
+#else
+  return 0;
+#endif
+}
+#endif
+
+/*
+ * mem_deinit - give the whole window back
+ */
+void mem_deinit(void)
+{
+#ifdef MM_PERSIST
+  if (mem_fd >= 0) {
+    munmap(mem_hdr, mem_pagesize() + MAX_HEAP);
+    close(mem_fd);
+    mem_fd = -1;
+    mem_hdr = NULL;
+    mem_start_brk = mem_brk = mem_commit = mem_max_addr = NULL;
+    return;
+  }
+#endif
+#ifdef MM_NUMA
+  int i;
+
+  for (i = 0; i < MEM_MAX_NODES; i++) {
+    if (i != mem_node && mem_nodes[i].start != NULL)
+      munmap(mem_nodes[i].start, MAX_HEAP);
+    mem_nodes[i].start = NULL;
+  }
+  mem_node = 0;
+#endif
+  munmap(mem_start_brk, MAX_HEAP);
+  mem_start_brk = mem_brk = mem_commit = mem_max_addr = NULL;
+}
+
+/*
+ * mem_reset_brk - reset the break to an empty heap
+ */
+void mem_reset_brk(void)
+{
+  SYNC_BRK();
+  mem_sbrk(-(int)(mem_brk - mem_start_brk));
+}
+
+/*
+ * commit - make [lo, hi) of the window usable, return 0 on success
+ */
+static int commit(char *lo, char *hi)
+{
+#ifdef MM_PERSIST
+  if (mem_fd >= 0)
+    return ftruncate(mem_fd, mem_pagesize() + (hi - mem_start_brk));
+#endif
+#ifdef MM_HUGEPAGES
+  /* Without MAP_NORESERVE this fails up front when the pool is short */
+  if (mmap(lo, hi - lo, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB, -1, 0) != MAP_FAILED)
+    return 0;
+  /* A failed MAP_FIXED may have unmapped the span, so map it again */
+  if (mmap(lo, hi - lo, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+    return -1;
+  madvise(lo, hi - lo, MADV_HUGEPAGE);
+  return 0;
+#else
+  return mprotect(lo, hi - lo, PROT_READ | PROT_WRITE);
+#endif
+}
+
+/*
+ * decommit - hand the pages of [lo, hi) back, they read as zero afterwards
+ */
+static void decommit(char *lo, char *hi)
+{
+#ifdef MM_PERSIST
+  if (mem_fd >= 0) {
+    if (ftruncate(mem_fd, mem_pagesize() + (lo - mem_start_brk)) == 0)
+      mem_commit = lo;
+    return;
+  }
+#endif
+  madvise(lo, hi - lo, MADV_DONTNEED);
+}
+
+/*
+ * mem_sbrk - move the break by incr bytes and return its old value.
+ *     Pages wholly above a lowered break are discarded and the rest of
+ *     the page the break falls in is cleared, so everything above the
+ *     break reads as zero when it grows over it again.
+ */
+void *mem_sbrk(int incr)
+{
+  char *old_brk;
+  char *top;
+  size_t pagesize = mem_pagesize();
+
+  SYNC_BRK();
+  old_brk = mem_brk;
+  if ((incr > 0 && incr > mem_max_addr - mem_brk) ||
+      (incr < 0 && -(long)incr > mem_brk - mem_start_brk)) {
+    errno = ENOMEM;
+    return (void *)-1;
+  }
+
+  if (incr > 0 && mem_brk + incr > mem_commit) {
+    top = mem_start_brk + ((mem_brk + incr - mem_start_brk + COMMIT_STEP - 1) & ~(COMMIT_STEP - 1));
+    if (top > mem_max_addr)
+      top = mem_max_addr;
+    if (commit(mem_commit, top) != 0) {
+      errno = ENOMEM;
+      return (void *)-1;
+    }
+    mem_commit = top;
+  }
+
+  if (incr < 0) {
+#ifdef MM_HUGEPAGES
+    pagesize = HUGE_PAGE;       /* never split a huge page */
+#endif
+    top = mem_start_brk + ((mem_brk + incr - mem_start_brk + pagesize - 1) & ~(pagesize - 1));
+    memset(mem_brk + incr, 0, (top < mem_brk ? top : mem_brk) - (mem_brk + incr));
+    if (top < mem_commit)
+      decommit(top, mem_commit);
+  }
+
+  mem_brk += incr;
+#ifdef MM_PERSIST
+  if (mem_fd >= 0) {
+    mem_hdr->brk = mem_brk - mem_start_brk;
+    mem_hdr->commit = mem_commit - mem_start_brk;
+  }
+#endif
+  return (void *)old_brk;
+}
+
+/*
+ * mem_purge - hand back the pages of [lo, hi), which must be page aligned,
+ *     while keeping them mapped. Returns 0 if they read as zero afterwards,
+ *     -1 if they could not be purged and keep their contents.
+ */
+int mem_purge(void *lo, void *hi)
+{
+#ifdef MM_PERSIST
+  /* Dropping pages of a shared file mapping only drops the cached copy */
+  if (mem_fd >= 0)
+    return madvise(lo, (char *)hi - (char *)lo, MADV_REMOVE);
+#endif
+  return madvise(lo, (char *)hi - (char *)lo, MADV_DONTNEED);
+}
+
+#ifdef MM_SEGMENTS
+/*
+ * mem_map - hand out size bytes of zeroed memory apart from the break,
+ *     rounded up to whole commit steps, NULL if the window has no room
+ *     left between the break and the spans
+ */
+void *mem_map(size_t size)
+{
+  char *p;
+  int i;
+
+  size = (size + COMMIT_STEP - 1) & ~(COMMIT_STEP - 1);
+
+  /* First fit among the spans given back, the rest of one stays there */
+  for (i = 0; i < mem_nspans; i++) {
+    if (mem_spans[i].size >= size) {
+      p = mem_spans[i].lo;
+      mem_spans[i].lo += size;
+      if ((mem_spans[i].size -= size) == 0)
+        mem_spans[i] = mem_spans[--mem_nspans];
+      if (commit(p, p + size) != 0)
+        return NULL;
+      return p;
+    }
+  }
+
+  if (size > (size_t)(mem_map_lo - mem_commit))
+    return NULL;
+  p = mem_map_lo - size;
+  if (commit(p, mem_map_lo) != 0)
+    return NULL;
+  mem_map_lo = mem_max_addr = p;
+  return p;
+}
+
+/*
+ * mem_unmap - take back a span of mem_map, its pages are discarded
+ */
+void mem_unmap(void *ptr, size_t size)
+{
+  char *p = ptr;
+  int i;
+
+  size = (size + COMMIT_STEP - 1) & ~(COMMIT_STEP - 1);
+  mmap(p, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0);
+
+  if (p != mem_map_lo) {
+    if (mem_nspans < MEM_MAX_SPANS) {
+      mem_spans[mem_nspans].lo = p;
+      mem_spans[mem_nspans++].size = size;
+    }
+    return;
+  }
+
+  /* The lowest span goes back to the break, with any spans it now touches */
+  mem_map_lo += size;
+  for (i = 0; i < mem_nspans; i++) {
+    if (mem_spans[i].lo == mem_map_lo) {
+      mem_map_lo += mem_spans[i].size;
+      mem_spans[i] = mem_spans[--mem_nspans];
+      i = -1;
+    }
+  }
+  mem_max_addr = mem_map_lo;
+}
+#endif
+
+#ifdef MM_LARGE
+/*
+ * mem_map_large - map size bytes of zeroed memory outside the window,
+ *     NULL if the OS refuses
+ */
+void *mem_map_large(size_t size)
+{
+  void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (p == MAP_FAILED)
+    return NULL;
+#ifdef MM_HUGEPAGES
+  madvise(p, size, MADV_HUGEPAGE);
+#endif
+  return p;
+}
+
+/*
+ * mem_remap_large - resize a mapping of mem_map_large to new_size bytes,
+ *     moving it if it cannot grow in place. NULL if the OS refuses, the
+ *     mapping is then left as it was.
+ */
+void *mem_remap_large(void *ptr, size_t size, size_t new_size)
+{
+  void *p = mremap(ptr, size, new_size, MREMAP_MAYMOVE);
+
+  return p == MAP_FAILED ? NULL : p;
+}
+
+/*
+ * mem_unmap_large - unmap a mapping of mem_map_large
+ */
+void mem_unmap_large(void *ptr, size_t size)
+{
+  munmap(ptr, size);
+}
+#endif
+
+#ifdef MM_FREE_CHECK
+/*
+ * mem_shadow - side memory of the current window, one bit for every 8 bytes
+ *     of it, which reads as zero when first mapped or when fresh is set.
+ *     *span is set to the bytes of window it covers. NULL if it cannot be
+ *     mapped.
+ */
+void *mem_shadow(size_t *span, int fresh)
+{
+  size_t size = MAX_HEAP / 64;
+  void *p;
+
+  if (mem_shadow_map == NULL) {
+    p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED)
+      return NULL;
+    mem_shadow_map = p;
+  }
+  else if (fresh)
+    madvise(mem_shadow_map, size, MADV_DONTNEED);
+  *span = MAX_HEAP;
+  return mem_shadow_map;
+}
+#endif
+
+#ifdef MM_BIN_INDEX
+/*
+ * mem_index - size bytes of side memory of the current window, the same
+ *     size every call, which read as zero when first mapped or when fresh
+ *     is set. NULL if it cannot be mapped.
+ */
+void *mem_index(size_t size, int fresh)
+{
+  void *p;
+
+  if (mem_index_map == NULL) {
+    p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED)
+      return NULL;
+    mem_index_map = p;
+  }
+  else if (fresh)
+    madvise(mem_index_map, size, MADV_DONTNEED);
+  return mem_index_map;
+}
+#endif
+
+/*
+ * mem_heap_lo - return address of the first heap byte
+ */
+void *mem_heap_lo(void)
+{
+  return (void *)mem_start_brk;
+}
+
+/*
+ * mem_heap_hi - return address of last heap byte
+ */
+void *mem_heap_hi(void)
+{
+  SYNC_BRK();
+  return (void *)(mem_brk - 1);
+}
+
+/*
+ * mem_heapsize() - returns the heap size in bytes
+ */
+size_t mem_heapsize(void)
+{
+  SYNC_BRK();
+  return (size_t)(mem_brk - mem_start_brk);
+}
+
+/*
+ * mem_pagesize() - returns the page size of the system
+ */
+size_t mem_pagesize(void)
+{
+  return (size_t)getpagesize();
+}
@@ -12,10 +12,22 @@
 #include <assert.h>
 #include <unistd.h>
 #include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <execinfo.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "mm.h"
+#include "mm_ext.h"
 #include "memlib.h"
 
+/* A shared heap is picked up by every process that attaches to it */
+#if defined(MM_SHARED) && !defined(MM_PERSIST)
+#define MM_PERSIST
+#endif
+
 /*********************************************************
  * NOTE TO STUDENTS: Before you do anything else, please
  * provide your information in the following struct.
@@ -30,8 +42,38 @@ student_t student = {
 /* Useful macros (some from book) */
 #define WSIZE       4       //header, footer size
 #define DSIZE       8       //total overhead size
+
+/*
+ * Tunables. A header generated by tools/autotune.py for a service's traces
+ * is passed as -DMM_TUNED_CONFIG='"mm_tuned.h"' and overrides the defaults.
+ */
+#ifdef MM_TUNED_CONFIG
+#include MM_TUNED_CONFIG
+#endif
+#ifndef CHUNKSIZE
 #define CHUNKSIZE  (1<<12)  //amnt to extend heap by
+#endif
+#ifndef INITCHUNKSIZE
 #define INITCHUNKSIZE (1<<6)
+#endif
+#ifndef NBINS
+#define NBINS      25       //number of segregated free lists
+#endif
+#ifndef BIN_STEP_BITS
+#define BIN_STEP_BITS 0     //lists per power of two are 1<<BIN_STEP_BITS
+#endif
+#ifndef SPLIT_THRESHOLD
+#define SPLIT_THRESHOLD 100 //place() puts requests this big at the end
+#endif
+#if NBINS < 2 || NBINS > 64
+#error "NBINS must be between 2 and 64"
+#endif
+#define CACHELINE  64       //MM_CACHELINE blocks own whole lines of this size
+#ifdef MM_HUGEPAGES
+#define TRIM_UNIT  (1<<21)  //mm_trim releases whole huge pages
+#else
+#define TRIM_UNIT  MAX(CHUNKSIZE, 1<<12)  //whole pages, a tuned CHUNKSIZE may be less
+#endif
 
 #define MAX(x, y) ((x) > (y)? (x) : (y))
 #define MIN(x, y) ((x) < (y)? (x) : (y))
@@ -40,10 +82,137 @@ student_t student = {
 
 #define GET(p)       (*(unsigned int *)(p)) //read word at address p
 #define PUT(p, val)  (*(unsigned int *)(p) = (val)) //write word at address p
-#define PUT_PTR(p, ptr) (*(unsigned int *)(p) = (unsigned int)(ptr)) // write predecessor or successor pointer  
+#define PUT_PTR(p, ptr) (*(unsigned int *)(p) = (ptr) ? (unsigned int)((char *)(ptr) - heap_base) : 0) // write predecessor or successor pointer as heap offset
 
 #define GET_SIZE(p)  (GET(p) & ~0x7) //extracts size from 4 byte header/footer
 #define GET_ALLOC(p) (GET(p) & 0x1) //extracts allocated byte from 4 byte header/footer
+#define GET_SAMPLED(p) (GET(p) & 0x2) //allocated block is tracked by the heap profiler
+
+/* 
+ * Define MM_SBRK_ZEROES when mem_sbrk hands out zeroed memory (memlib_os.c does,
+ * the lab's memlib does not). Free blocks then carry CLEAN_TAG while all their bytes
+ * but header, footer and the two link words are zero, and meta->zero_hwm bounds the part
+ * of the heap payloads were ever placed in, so mm_calloc only zeroes what may be dirty.
+ */
+#ifdef MM_SBRK_ZEROES
+#define CLEAN_TAG   0x4
+#else
+#define CLEAN_TAG   0
+#endif
+#define GET_CLEAN(p) (GET(p) & CLEAN_TAG) //free block is known zero
+#define NT_ZERO_MIN (1<<18) //zero at least this many bytes with non-temporal stores
+#define PURGE_MIN   (1<<16) //mm_purge leaves smaller free blocks alone
+
+/* Handle blocks may be moved by mm_compact, their payload starts with the slot of their handle */
+#define MOVABLE_TAG 0x4
+#define GET_MOVABLE(p) ((GET(p) & (MOVABLE_TAG | 0x1)) == (MOVABLE_TAG | 0x1)) //allocated block belongs to a handle
+
+/* The footer of a prewarm fence carries FENCE_TAG, and CLEAN_TAG if its payload is zero, see mm_prewarm */
+#define FENCE_TAG   0x2
+#define IS_FENCE(ptr) ((GET(FTRP(ptr)) & (FENCE_TAG | 0x1)) == (FENCE_TAG | 0x1))
+#define HPAD        ALIGNMENT //bytes in front of the payload of a handle block
+#define HSLOTS      128       //handle slots allocated at a time
+
+/* Parts of the placement policy word of mm_ext.h */
+#define FIT(p)      ((p) & 0xf)
+#define ORDER(p)    ((p) & 0xf0)
+#define SPLIT(p)    ((p) & 0xf00)
+#define BOUND(p)    ((unsigned int)(p) >> 16) //blocks MM_FIT_GOOD looks at past the first fit
+
+/*
+ * With MM_SEGMENTS the heap may also have segments apart from the break, from
+ * memlib's mem_map. Each starts with its own prologue and ends with its own
+ * epilogue, so the blocks of a segment never merge with anything outside it.
+ * Requests of SEG_THRESHOLD bytes or more get a segment of their own, and a
+ * segment goes back to memlib once all of it is one free block again.
+ */
+#ifdef MM_SEGMENTS
+#define SEG_THRESHOLD (1<<20) //blocks this large are placed in a new segment
+#define SEG_MAX     4096      //segments at a time
+#ifdef MM_HUGEPAGES
+#define SEG_UNIT    (1<<21)   //mem_map hands out whole huge pages
+#else
+#define SEG_UNIT    (1<<16)
+#endif
+#define IN_SEGMENT(ptr) ((char *)(ptr) >= seg_floor) //segments lie above the break
+#else
+#define IN_SEGMENT(ptr) 0
+#endif
+
+/*
+ * The heap's block sizes are 4 byte words and it spans 4 GB at most. With
+ * MM_LARGE, requests of LARGE_MIN bytes and more get a mapping of their own
+ * from memlib's mem_map_large instead. Their header word is LARGE_TAG, size
+ * 0 with every tag bit set, which no heap block has, and the descriptor in
+ * front of it holds the size of the mapping. Without MM_LARGE, requests the
+ * break cannot hand out fail.
+ */
+#ifdef MM_LARGE
+#define LARGE_MIN   ((size_t)1 << 30) //requests this large are mapped on their own
+#define IS_LARGE(ptr) (GET(HDRP(ptr)) == LARGE_TAG)
+#else
+#define LARGE_MIN   ((size_t)-1)
+#define IS_LARGE(ptr) 0
+#endif
+#define LARGE_TAG   0x7
+#define LARGE_PAD   (4 * ALIGNMENT)   //descriptor and header in front of the payload
+#define LARGE_DESC(ptr) ((large_t *)((char *)(ptr) - LARGE_PAD))
+
+/*
+ * With MM_FREE_CHECK, a bitmap from memlib's mem_shadow has a bit for every
+ * LIVE_GRAIN bytes of the heap window, set where an allocated block starts.
+ * mm_free tests it before trusting the header, so a pointer into the middle
+ * of a block, a block freed already or one outside the heap is rejected
+ * in O(1), whatever the bytes in front of it hold. Without it only the
+ * alloc bit of the header is looked at.
+ */
+#ifdef MM_FREE_CHECK
+#define LIVE_GRAIN  8
+#define LIVE_WBITS  (8 * sizeof(unsigned long))
+#define LIVE_BIT(ptr) ((size_t)((char *)(ptr) - heap_base) / LIVE_GRAIN)
+#define LIVE_WORD(ptr) live_map[LIVE_BIT(ptr) / LIVE_WBITS]
+#define LIVE_MASK(ptr) (1UL << (LIVE_BIT(ptr) % LIVE_WBITS))
+#define IS_LIVE(ptr) is_live(ptr)
+#define MARK_LIVE(ptr) (LIVE_WORD(ptr) |= LIVE_MASK(ptr))
+#define MARK_DEAD(ptr) (LIVE_WORD(ptr) &= ~LIVE_MASK(ptr))
+#else
+#define IS_LIVE(ptr) GET_ALLOC(HDRP(ptr))
+#define MARK_LIVE(ptr) ((void)0)
+#define MARK_DEAD(ptr) ((void)0)
+#endif
+
+/*
+ * With MM_BIN_INDEX every list also has an index in memory from memlib's
+ * mem_index: the sizes and the heap offsets of its blocks in two dense
+ * arrays, kept in list order by insert_bin and delete_node. bin_fit scans
+ * the sizes, four at a time with SSE2, and reads block memory only for the
+ * block it picks. insert_bin finds a block's place in its list by binary
+ * search in the index instead of walking the list, so address ordered lists
+ * (MM_ORDER_ADDR) cost O(log n) compares per insert and delete like sorted
+ * arrays. An index holds its list from the tail up, the root being the last
+ * entry, so blocks inserted or taken near the root move few entries. Blocks
+ * of one size are kept by address, the highest nearest the root, so every
+ * block has one place that a binary search finds. The index is private to
+ * the process, reattach builds it along with the lists from the blocks.
+ */
+#ifdef MM_BIN_INDEX
+#if ULONG_MAX > 0xffffffffUL
+#define IX_SPAN     ((size_t)1 << 32) //most heap the offsets reach
+#else
+#define IX_SPAN     ((size_t)1 << 30)
+#endif
+#define IX_COUNT(i) (((unsigned int *)bin_ix)[i])
+#define IX_SIZES(i) ((unsigned int *)(bin_ix + ix_at[i]))
+#define IX_OFFS(i)  (IX_SIZES(i) + ix_cap[i])
+#define IX_BLOCK(i, j) (heap_base + IX_OFFS(i)[j])
+#endif
+
+// the placement policy, a constant the compiler folds when fixed with MM_POLICY
+#ifdef MM_POLICY
+#define POLICY      (MM_POLICY)
+#else
+#define POLICY      ((int)meta->policy)
+#endif
 
 // get addr of previous & next block
 #define NEXT(ptr)  ((char *)(ptr) + GET_SIZE(((char *)(ptr) - WSIZE))) 
@@ -58,51 +227,370 @@ student_t student = {
 #define SUCC_ENT(ptr) ((char *)(ptr) + WSIZE)
 
 // get ptr's predecessor and successor on the segregated list 
-#define PRED_LIST(ptr) (*(char **)(ptr))
-#define SUCC_LIST(ptr) (*(char **)(SUCC_ENT(ptr)))
+// links are 4 byte offsets from heap_base so they also fit on 64 bit hosts, 0 is NULL
+#define PRED_LIST(ptr) (GET(PRED_ENT(ptr)) ? heap_base + GET(PRED_ENT(ptr)) : NULL)
+#define SUCC_LIST(ptr) (GET(SUCC_ENT(ptr)) ? heap_base + GET(SUCC_ENT(ptr)) : NULL)
+
+// read a pointer written with PUT_PTR
+#define GET_PTR(p) (GET(p) ? heap_base + GET(p) : NULL)
 
-/* single word (4) or double word (8) alignment */
-#define ALIGNMENT 8
+// head of segregated list i, kept in the heap's meta block
+#define LIST_ROOT(i)      GET_PTR(&meta->roots[i])
+#define SET_ROOT(i, ptr)  PUT_PTR(&meta->roots[i], ptr)
+
+/* double word (8) alignment, two pointers (16) like the C library on 64 bit hosts */
+#define ALIGNMENT (2 * sizeof(void *))
 /* rounds up to the nearest multiple of ALIGNMENT */
-#define ALIGN(size) (((size) + (ALIGNMENT-1)) & ~0x7)
+#define ALIGN(size) (((size) + (ALIGNMENT-1)) & ~(ALIGNMENT-1))
+
+// zero the footer before ptr, ptr's header and its links when coalescing makes them interior
+#define ZERO_SEAM(ptr) do { if (CLEAN_TAG) memset((char *)(ptr) - DSIZE, 0, 2 * DSIZE); } while (0)
+// block ptr was merged into block into, keep the compactor's and the checker's cursors on a block
+#define FORGET_BLOCK(ptr, into) do { if (GET_PTR(&meta->cursor) == (char *)(ptr)) PUT_PTR(&meta->cursor, into); \
+                                     if (GET_PTR(&meta->check) == (char *)(ptr)) PUT_PTR(&meta->check, into); } while (0)
+// raise zero_hwm over the payload of newly allocated block ptr and over the footer, header and links
+// a free block split off after it leaves in a block they merge into, segments rely on clean tags alone
+#define NOTE_USED(ptr) do { if (CLEAN_TAG && (char *)FTRP(ptr) + 2*DSIZE > heap_base + meta->zero_hwm && !IN_SEGMENT(ptr)) \
+                              meta->zero_hwm = (char *)FTRP(ptr) + 2*DSIZE - heap_base; } while (0)
 
 /*non-static functions */
 int mm_init(range_t **ranges);
 void* mm_malloc(size_t size);
 void mm_free(void *ptr);
 void mm_exit(void);
+void* mm_realloc(void *ptr, size_t size);
 
 /* Useful Functions*/
+static size_t adjust_size(size_t size);
 static void *extend_heap(size_t words);
+static void *grow_heap(size_t asize);
+static void release_segment(char *ptr);
+static void *large_alloc(size_t size, size_t align);
+static void *large_resize(void *ptr, size_t size);
+static void large_free(void *ptr);
+#ifdef MM_FREE_CHECK
+static int is_live(char *ptr);
+#endif
+static char *first_block(int r);
+#ifdef MM_SEGMENTS
+static int seg_of(char *ptr);
+#endif
+static void *search_fit(size_t asize);
+static char *bin_fit(int i, size_t asize);
+static void *find_fit(size_t asize);
 static void *coalesce(void *ptr);
+static void *drop_fences(char *ptr);
 static void *place(void *ptr, size_t asize);
+static char *aligned_fit(char *ptr, size_t align, size_t asize);
+static void *place_aligned(char *ptr, char *aptr, size_t asize);
 static void insert_node(void *ptr, size_t size);
+static void insert_bin(void *ptr, size_t size, int i);
+#ifndef MM_POLICY
+static void sort_lists(void);
+#endif
 static void delete_node(void *ptr);
+static int bin_index(size_t size);
+static size_t bin_min(int i);
+static void sort_ptrs(void **ptrs, int n);
+#ifdef MM_PERSIST
+static int reattach(int others);
+#endif
+static void zero_bytes(char *p, size_t len);
+static void sample_alloc(void *ptr, size_t size);
+static void sample_free(void *ptr);
+static void check_tick(void);
+static int relieve(size_t grow);
+static int over_hard(size_t grow);
+static int check_block(char *ptr, char *end);
+static int check_link(char *ptr);
+#ifdef MM_BIN_INDEX
+static int ix_open(int fresh);
+static int ix_below(int i, int j, unsigned int size, unsigned int off);
+static int ix_find(int i, char *ptr);
+static int ix_fit(int i, int lo, int hi, size_t asize);
+static int ix_insert(int i, char *ptr, size_t size);
+static void ix_delete(int i, char *ptr);
+#endif
+
+/* Heap profiler: one live sample per slot, SAMPLE_SLOTS is a power of two */
+#define SAMPLE_SLOTS  1024
+#define SAMPLE_DEPTH  32
+
+typedef struct {
+  void *ptr;                   /* sampled block, NULL if the slot is empty */
+  size_t size;                 /* requested size */
+  int depth;                   /* number of frames in stack */
+  void *stack[SAMPLE_DEPTH];
+} sample_t;
+
+/*
+ * The heap starts with a meta block holding everything needed to pick the
+ * heap up again, as offsets from heap_base. With MM_PERSIST and a heap file
+ * (see memlib_os.c) mm_init finds it there after a restart.
+ */
+
+#define HEAP_MAGIC    0x48484d4d    /* "MMHH" */
+#define HEAP_VERSION  4
+
+typedef struct {
+  unsigned int magic;
+  unsigned int version;
+  unsigned int nbins;          /* NBINS of the build that made the heap */
+  unsigned int roots[NBINS];   /* heads of the segregated free lists */
+  unsigned int free_handles;   /* first free handle slot */
+  unsigned int user_root;      /* set with mm_set_root */
+  unsigned int zero_hwm;       /* no payload was ever placed above this */
+  unsigned int cursor;         /* where mm_compact resumes, 0 = heap start */
+  unsigned int policy;         /* placement policy, see mm_ext.h */
+  unsigned int rover;          /* where MM_FIT_NEXT resumes in its list */
+  unsigned int check;          /* where mm_check resumes, 0 = heap start */
+} heap_meta_t;
+
+#define META_SIZE ALIGN(sizeof(heap_meta_t))
+
+/* Handle of a relocatable block, mm_handle_t in mm_ext.h */
+struct mm_handle {
+  void *ptr;                   /* payload, or the next free slot */
+  unsigned int locks;          /* block stays in place while nonzero */
+};
+
+/* Descriptor of a large block, LARGE_PAD bytes before its payload */
+typedef struct large {
+  char *map;                   /* start of the mapping */
+  size_t len;                  /* bytes mapped */
+  struct large *prev, *next;   /* all large blocks, mm_init unmaps them */
+} large_t;
 
 /* Global variables*/
-void *segregated_free_lists[25]; 
+static heap_meta_t *meta;             /* start of the heap */
 static range_t **gl_ranges;
+static char *heap_listp;              /* prologue block */
+static char *heap_base;               /* mem_heap_lo(), origin of the list links */
+
+#ifdef MM_SBRK_ZEROES
+int mem_purge(void *lo, void *hi);
+#endif
+#ifdef MM_PERSIST
+int mem_others(void);
+#endif
+#ifdef MM_SEGMENTS
+void *mem_map(size_t size);
+void mem_unmap(void *ptr, size_t size);
+
+/* Segments sorted by address, the list links reach them as offsets too */
+static struct {
+  char *start;
+  size_t size;
+} segs[SEG_MAX];
+static int nsegs;
+static char *seg_floor = (char *)-1;  /* start of the lowest segment */
+#endif
+#ifdef MM_FREE_CHECK
+void *mem_shadow(size_t *span, int fresh);
+
+static unsigned long *live_map;       /* bitmap of block starts, see MARK_LIVE */
+static size_t live_span;              /* bytes of the window live_map covers */
+#endif
+#ifdef MM_BIN_INDEX
+void *mem_index(size_t size, int fresh);
+
+static char *bin_ix;                  /* index of the current heap, see IX_COUNT */
+static size_t ix_at[NBINS];           /* where in it each list's arrays start */
+static size_t ix_cap[NBINS];          /* entries each list's arrays hold */
+static size_t ix_size;                /* bytes of the index, 0 until laid out */
+#endif
+#ifdef MM_LARGE
+void *mem_map_large(size_t size);
+void *mem_remap_large(void *ptr, size_t size, size_t new_size);
+void mem_unmap_large(void *ptr, size_t size);
+
+static large_t *large_list;
+#endif
+
+static sample_t samples[SAMPLE_SLOTS];
+static int sample_count;
+static size_t sample_rate;            /* mean bytes between samples, 0 = off */
+static long sample_countdown = LONG_MAX; /* bytes left until the next sample */
+static unsigned int sample_seed = 2463534242u;
+
+static long check_countdown = LONG_MAX; /* mm_malloc and mm_free calls until the next check */
+static long check_every;              /* calls between checks, 0 = off */
+static size_t check_budget;           /* blocks each check looks at */
+
+/*
+ * Memory budget, see mm_set_limits. The footprint is every byte mapped from
+ * memlib: the heap up to the break, segments and large blocks. Growth past
+ * the soft limit first runs relief, growth past the hard limit fails.
+ */
+static size_t footprint;
+static size_t soft_limit;             /* 0 = none */
+static size_t hard_limit = (size_t)-1;
+static size_t pressure_mark;          /* footprint relief runs again past */
+static mm_pressure_fn pressure_fn;
+static void *pressure_arg;
+static int relieving;                 /* relief is running */
 
 //--------------------------------------------------------------------------------
+/*
+ * The driver's range list is indexed by a hash table keyed by lo, holding
+ * for each range the link that points to it, so remove_range unlinks a
+ * range without walking the list. The driver puts new ranges at the head,
+ * so before a lookup the index takes in the ranges in front of the ones it
+ * has. A range it does not have is looked for in the list as before.
+ */
+typedef struct {
+  range_t *range;              /* NULL if the slot is empty */
+  range_t **link;              /* list head or next field pointing at range */
+  unsigned int sync;           /* range_sync call that added it */
+} range_slot_t;
+
+#define RANGE_HASH(lo) ((((unsigned long)(lo) >> 3) * 2654435761u) & (range_cap - 1))
+
+static range_slot_t *range_index;
+static size_t range_cap, range_count; /* cap is zero or a power of two */
+static range_t *range_head;           /* head of the list at the last sync */
+static unsigned int range_syncs;
+
+/*
+ * range_slot - slot of lo in the index, or the empty slot its probe ends at
+ */
+static size_t range_slot(char *lo)
+{
+  size_t i = RANGE_HASH(lo);
+
+  while (range_index[i].range != NULL && range_index[i].range->lo != lo)
+    i = (i + 1) & (range_cap - 1);
+  return i;
+}
+
+/*
+ * range_find - slot of range r in the index, -1 if r is not in it
+ */
+static long range_find(range_t *r)
+{
+  size_t i;
+
+  if (range_count == 0)
+    return -1;
+  i = range_slot(r->lo);
+  return range_index[i].range == r ? (long)i : -1;
+}
+
+static void range_put(range_t *r, range_t **link)
+{
+  range_slot_t *old = range_index;
+  size_t oldcap = range_cap, i;
+
+  /* Keep the index at most half full */
+  if (2 * (range_count + 1) > range_cap) {
+    if ((range_index = calloc(oldcap ? 2 * oldcap : 1024, sizeof(range_slot_t))) == NULL) {
+      range_index = old;
+      return;                          /* r stays out, it is found by the list walk */
+    }
+    range_cap = oldcap ? 2 * oldcap : 1024;
+    for (i = 0; i < oldcap; i++)
+      if (old[i].range != NULL)
+        range_index[range_slot(old[i].range->lo)] = old[i];
+    free(old);
+  }
+
+  /* Of ranges with the same lo the one nearest the head is removed first */
+  i = range_slot(r->lo);
+  if (range_index[i].range != NULL && range_index[i].sync == range_syncs)
+    return;
+  if (range_index[i].range == NULL)
+    range_count++;
+  range_index[i].range = r;
+  range_index[i].link = link;
+  range_index[i].sync = range_syncs;
+}
+
+/*
+ * range_del - empty slot i, moving later slots of its probe back into it
+ */
+static void range_del(size_t i)
+{
+  size_t j = i, home;
+
+  range_count--;
+  for (;;) {
+    range_index[i].range = NULL;
+    do {
+      j = (j + 1) & (range_cap - 1);
+      if (range_index[j].range == NULL)
+        return;
+      home = RANGE_HASH(range_index[j].range->lo);
+    } while (i <= j ? (i < home && home <= j) : (i < home || home <= j));
+    range_index[i] = range_index[j];
+    i = j;
+  }
+}
+
+/*
+ * range_sync - index the ranges added at the head of the list since the last call
+ */
+static void range_sync(range_t **ranges)
+{
+  range_t **link = ranges;
+  range_t *r;
+  long i;
+
+  range_syncs++;
+  for (r = *ranges; r != NULL; link = &r->next, r = r->next) {
+    if ((i = range_find(r)) >= 0) {
+      range_index[i].link = link;        /* the first range it had before */
+      break;
+    }
+    range_put(r, link);
+  }
+  range_head = *ranges;
+}
+
 /* 
  * remove_range - manipulate range lists
  */
 static void remove_range(range_t **ranges, char *lo)
 {
-  range_t *p;
+  range_t *p = NULL;
   range_t **prevpp = ranges;
+  size_t i;
+  long j;
   
   if (!ranges)
     return;
 
-  for (p = *ranges;  p != NULL; p = p->next) {
-    if (p->lo == lo) {
-      *prevpp = p->next;
-      free(p);
-      break;
-    }
-    prevpp = &(p->next);
+  if (*ranges != range_head)
+    range_sync(ranges);
+  if (range_count > 0 && (p = range_index[i = range_slot(lo)].range) != NULL) {
+    prevpp = range_index[i].link;
+    range_del(i);
   }
+  else {
+    for (p = *ranges; p != NULL && p->lo != lo; p = p->next)
+      prevpp = &(p->next);
+    if (p == NULL)
+      return;
+    if ((j = range_find(p)) >= 0)
+      range_del(j);
+  }
+
+  /* The range after p is now pointed at from where p was */
+  *prevpp = p->next;
+  if (p->next != NULL && (j = range_find(p->next)) >= 0)
+    range_index[j].link = prevpp;
+  range_head = *ranges;
+  free(p);
+}
+
+/*
+ * range_reset - forget the index, the driver starts a new list with mm_init
+ */
+static void range_reset(void)
+{
+  free(range_index);
+  range_index = NULL;
+  range_cap = range_count = 0;
+  range_head = NULL;
 }
 
 /*
@@ -121,33 +609,212 @@ void handle_double_free(void) {
 /*
  * mm_init - initialize the malloc package.
  * create the initial, very first empty heap\
- * Initialize the segregated free lists (list max length=25)
+ * Initialize the segregated free lists (NBINS of them)
  */
 int mm_init(range_t **ranges)
 {
-  int i;
-  char *heap_listp;
-  
-  /* Initialize array of pointers to segregated free lists */
-  for (i = 0; i < 25; i++) {
-    segregated_free_lists[i] = NULL;
+#ifdef MM_PERSIST
+  int others;
+#endif
+
+  /* Samples of a previous heap are gone with it, NUMA heaps are only added */
+#ifndef MM_NUMA
+  if (sample_count) {
+    memset(samples, 0, sizeof(samples));
+    sample_count = 0;
+  }
+#endif
+
+  heap_base = mem_heap_lo();
+  meta = (heap_meta_t *)heap_base;
+  gl_ranges = ranges;
+  range_reset();
+
+#ifdef MM_SEGMENTS
+  /* Segments of the previous heap go with it */
+  while (nsegs > 0) {
+    nsegs--;
+    mem_unmap(segs[nsegs].start, segs[nsegs].size);
   }
+  seg_floor = (char *)-1;
+#endif
+#if defined(MM_LARGE) && !defined(MM_NUMA)
+  /* So do its large blocks */
+  while (large_list != NULL)
+    large_free((char *)large_list + LARGE_PAD);
+#endif
+#ifndef MM_NUMA
+  footprint = 0;
+#endif
+#ifdef MM_FREE_CHECK
+  /* Bits of a previous heap are stale, reattach sets those of this one */
+  if ((live_map = mem_shadow(&live_span, 1)) == NULL)
+    return -1;
+#endif
+#ifdef MM_BIN_INDEX
+  if (ix_open(1) < 0)
+    return -1;
+#endif
 
-  /* Create the initial empty heap */
+#ifdef MM_PERSIST
+  /* A heap file left by an earlier run, or by another process attached
+     to the same shared heap, is checked and carried on with. Asking
+     whether others are attached counts this process in, also when it
+     creates the heap. */
+  others = mem_others();
+  if (mem_heapsize() > 0)
+    return reattach(others);
+#endif
+
+  /* Create the initial empty heap, the free lists start out empty */
+  if ((long)mem_sbrk(META_SIZE) == -1) return -1;
+  memset(meta, 0, META_SIZE);
+  meta->magic = HEAP_MAGIC;
+  meta->version = HEAP_VERSION;
+  meta->nbins = NBINS;
+#ifdef MM_POLICY
+  meta->policy = MM_POLICY;
+#endif
   if ((long)(heap_listp = mem_sbrk(4*WSIZE)) == -1) return -1;
+  footprint += META_SIZE + 4*WSIZE;
 
   PUT(heap_listp, 0); 			                   	 /* alignment padding */
   PUT(heap_listp + (1*WSIZE), PACK(DSIZE, 1)); 	/* prologue header */
   PUT(heap_listp + (2*WSIZE), PACK(DSIZE, 1));	/* prologue footer */
   PUT(heap_listp + (3*WSIZE), PACK(0, 1)); 	    /* epliogue header */
+  heap_listp += (2*WSIZE);                      /* prologue block */
 
   /* Extend the empty heap with a free block of CHUNKSIZE bytes */
   if(extend_heap(INITCHUNKSIZE) == NULL) return -1;
 
-  gl_ranges = ranges;
   return 0;
 }
 
+#ifdef MM_PERSIST
+/*
+ * reattach - take over the heap of an earlier run.
+ *     The blocks have to tile the heap from the prologue to an epilogue
+ *     at the break, otherwise the heap is refused. Profile samples belonged
+ *     to the old process, so their tags are dropped. A run that died in
+ *     the middle of a free or a split may have left the list links half
+ *     written, so the lists are built again from the blocks, merging free
+ *     blocks that were not merged yet. A shared heap that other processes
+ *     are using is only checked, its tags, lists and meta block are theirs.
+ */
+static int reattach(int others)
+{
+  char *ptr, *end = (char *)mem_heap_hi() + 1;
+  size_t size;
+  unsigned int clean;
+  int i;
+
+  if (mem_heapsize() < META_SIZE + 4*WSIZE ||
+      meta->magic != HEAP_MAGIC || meta->version != HEAP_VERSION ||
+      meta->nbins != NBINS)
+    return -1;
+  heap_listp = heap_base + META_SIZE + 2*WSIZE;
+  if (GET(HDRP(heap_listp)) != PACK(DSIZE, 1))
+    return -1;
+
+  for (ptr = NEXT(heap_listp); GET_SIZE(HDRP(ptr)) > 0; ptr = NEXT(ptr)) {
+    if (GET_SIZE(HDRP(ptr)) < 2 * DSIZE || (char *)FTRP(ptr) + DSIZE > end ||
+        GET_SIZE(FTRP(ptr)) != GET_SIZE(HDRP(ptr)))
+      return -1;
+    if (!others && GET_ALLOC(HDRP(ptr)) && GET_SAMPLED(HDRP(ptr)))
+      PUT(HDRP(ptr), GET(HDRP(ptr)) & ~0x2);
+    if (GET_ALLOC(HDRP(ptr)))
+      MARK_LIVE(ptr);
+  }
+  if (ptr != end || GET(HDRP(ptr)) != PACK(0, 1))
+    return -1;
+
+  footprint += mem_heapsize();
+  if (others)
+    return 0;
+
+  meta->zero_hwm = end - heap_base;
+  meta->check = 0;
+  meta->rover = 0;
+#ifdef MM_POLICY
+  meta->policy = MM_POLICY;
+#endif
+
+  for (i = 0; i < NBINS; i++) {
+    SET_ROOT(i, NULL);
+#ifdef MM_BIN_INDEX
+    IX_COUNT(i) = 0;
+#endif
+  }
+  /* From the top down, so with MM_ORDER_ADDR each block goes in at the head */
+  for (ptr = PREV(end); ptr != heap_listp; ptr = PREV(ptr)) {
+    if (GET_ALLOC(HDRP(ptr)))
+      continue;
+    size = GET_SIZE(HDRP(ptr));
+    clean = GET_CLEAN(HDRP(ptr));
+    while (!GET_ALLOC(HDRP(PREV(ptr)))) {
+      ptr = PREV(ptr);
+      size += GET_SIZE(HDRP(ptr));
+      clean &= GET_CLEAN(HDRP(ptr));
+    }
+    PUT(HDRP(ptr), PACK(size, 0) | clean);
+    PUT(FTRP(ptr), PACK(size, 0));
+    insert_node(ptr, size);
+  }
+  return 0;
+}
+#endif
+
+/*
+ * mm_use_heap - switch to the heap memlib has selected, which mm_init
+ *     has been run on before. All other state of a heap is in its meta block.
+ */
+void mm_use_heap(void)
+{
+  heap_base = mem_heap_lo();
+  meta = (heap_meta_t *)heap_base;
+  heap_listp = heap_base + META_SIZE + 2*WSIZE;
+#ifdef MM_FREE_CHECK
+  live_map = mem_shadow(&live_span, 0);
+#endif
+#ifdef MM_BIN_INDEX
+  ix_open(0);
+#endif
+}
+
+/*
+ * mm_set_policy - choose how free blocks are found, kept in their lists
+ *     and split, see mm_ext.h. A new list order re-sorts the lists.
+ *     Returns -1 if mm.c was built with another MM_POLICY.
+ */
+int mm_set_policy(int policy)
+{
+#ifdef MM_POLICY
+  return policy == MM_POLICY ? 0 : -1;
+#else
+  int old = meta->policy;
+
+  meta->policy = policy;
+  meta->rover = 0;
+  if (ORDER(old) != ORDER(policy))
+    sort_lists();
+  return 0;
+#endif
+}
+
+/*
+ * mm_set_root - remember ptr in the heap, where mm_get_root finds it
+ *     after a persistent heap is reattached.
+ */
+void mm_set_root(void *ptr)
+{
+  PUT_PTR(&meta->user_root, ptr);
+}
+
+void* mm_get_root(void)
+{
+  return GET_PTR(&meta->user_root);
+}
+
 
 /*
  * mm_malloc - Allocate a block by incrementing the brk pointer.
@@ -156,61 +823,103 @@ int mm_init(range_t **ranges)
 void* mm_malloc(size_t size)
 {
   size_t asize;       /* Adjusted block size */
-  size_t extendsize;  /* Extend heap with this size if no fit free block */
-  void *ptr=NULL;
+  void *ptr;
+
+  if (--check_countdown == 0)
+    check_tick();
 
   /* Ignore spurious requests */
   if (size == 0)
     return NULL;
 
   /* Adjust block size to align */
-  if (size <= DSIZE)
-    asize = 2 * DSIZE;
-  else
-    asize = ALIGN(size + DSIZE);
+  if ((asize = adjust_size(size)) == 0)
+    return NULL;
   
-  /* Search throught the segregated_free_list for the free block*/
-  int i =0;
-  size_t ssize=asize;
-  while (i < 25) {
-      if ((i == 24) || ((ssize <= 1) && (segregated_free_lists[i] != NULL))) {
-          ptr = segregated_free_lists[i];
-          while ((ptr != NULL) && (asize > GET_SIZE(HDRP(ptr))))
-          {
-              ptr = PRED_LIST(ptr);
-          }
-          if (ptr != NULL)
-              break;
-      }
-      ssize >>= 1;
-      i++;
+  if (asize >= LARGE_MIN)
+    ptr = large_alloc(size, ALIGNMENT);
+  else if ((ptr = find_fit(asize)) != NULL)
+    ptr = place(ptr, asize);
+  if (ptr == NULL)
+    return NULL;
+
+  /* Unsampled allocations only pay for this decrement */
+  if ((sample_countdown -= size) < 0)
+    sample_alloc(ptr, size);
+  return ptr;
+ }
+
+/*
+ * mm_calloc - Allocate a zeroed array of nmemb elements of size bytes.
+ *     With MM_SBRK_ZEROES only the bytes that may have been written are
+ *     zeroed: none of a clean block but its list links, and of any other
+ *     block the part below zero_hwm.
+ */
+void* mm_calloc(size_t nmemb, size_t size)
+{
+  size_t asize, bytes;
+  unsigned int clean;
+  char *ptr, *hwm, *end;
+
+  if (nmemb == 0 || size == 0 || nmemb > (size_t)-1 / size)
+    return NULL;
+  bytes = nmemb * size;
+
+  if ((asize = adjust_size(bytes)) == 0)
+    return NULL;
+
+  /* A new mapping reads as zero */
+  if (asize >= LARGE_MIN) {
+    if ((ptr = large_alloc(bytes, ALIGNMENT)) != NULL && (sample_countdown -= bytes) < 0)
+      sample_alloc(ptr, bytes);
+    return ptr;
   }
 
-  /* No fit found. Get more memory by extending */
-  if(ptr ==NULL){
-    extendsize = MAX(asize,CHUNKSIZE);
-    
-    if ((ptr = extend_heap(extendsize)) == NULL)
-      return NULL;
+  if ((ptr = find_fit(asize)) == NULL)
+    return NULL;
+
+  clean = GET_CLEAN(HDRP(ptr));
+  hwm = IN_SEGMENT(ptr) ? (char *)-1 : heap_base + meta->zero_hwm;
+  ptr = place(ptr, asize);
+
+  if (!CLEAN_TAG)
+    end = ptr + bytes;
+  else {
+    end = clean ? ptr : MIN(ptr + bytes, hwm);
+    end = MAX(end, ptr + MIN(bytes, DSIZE));  /* the links of the free block */
   }
-  
-  place(ptr, asize);
+  zero_bytes(ptr, end - ptr);
+
+  if ((sample_countdown -= bytes) < 0)
+    sample_alloc(ptr, bytes);
   return ptr;
- }
+}
 
 /*
  * mm_free - Freeing a block 
- * If the allocation bit of the block that we are trying to free is 0, then call handle_double_free
+ * If the block that we are trying to free is not allocated (see IS_LIVE), then call handle_double_free
  * Else, free the block by setting allocation bit to 0 and coalescing the adjacent freed block
  */
 void mm_free(void *ptr)
 {
   if (!ptr) return;
+  if (--check_countdown == 0)
+    check_tick();
+  //call double_handle_free when try to free the freed block
+  if (!IS_LIVE(ptr))
+    handle_double_free();
+  if (IS_LARGE(ptr)) {
+    sample_free(ptr);
+    large_free(ptr);
+    if (gl_ranges)
+      remove_range(gl_ranges, ptr);
+    return;
+  }
   size_t size = GET_SIZE(HDRP(ptr));
 
- //call double_handle_free when try to free the freed block
-  if ((GET_ALLOC(HDRP(ptr)))==0)
-    handle_double_free();
+  MARK_DEAD(ptr);
+  if (GET_SAMPLED(HDRP(ptr)))
+    sample_free(ptr);
  
   // set header and footer to unallocated 
   PUT(HDRP(ptr), PACK(size,0));
@@ -219,7 +928,7 @@ void mm_free(void *ptr)
   
   //coalesce the adjacent freed block
   insert_node(ptr, size);
-  coalesce(ptr);
+  release_segment(drop_fences(coalesce(ptr)));
   
   if (gl_ranges)
     remove_range(gl_ranges, ptr);
@@ -227,101 +936,1304 @@ void mm_free(void *ptr)
 }
 
 /*
- * mm_realloc - empty implementation; YOU DO NOT NEED TO IMPLEMENT THIS
+ * mm_realloc - Resize the block of ptr to at least size bytes.
+ *     Shrinking, growing within the slack of the block or into a free block
+ *     after it keeps it in place, otherwise the payload is copied to a new
+ *     block and the old one freed. Large blocks that stay large are
+ *     remapped, so their pages are not copied.
  */
-void* mm_realloc(void *ptr, size_t t)
+void* mm_realloc(void *ptr, size_t size)
 {
-  return NULL;
+  void *newptr;
+  size_t copysize;
+
+  if (ptr == NULL)
+    return mm_malloc(size);
+  if (size == 0) {
+    mm_free(ptr);
+    return NULL;
+  }
+
+  copysize = mm_usable_size(ptr);
+  if (IS_LARGE(ptr)) {
+    if (size >= LARGE_MIN && (newptr = large_resize(ptr, size)) != NULL)
+      return newptr;
+  }
+  else if (size <= copysize || mm_try_expand(ptr, size, size) != 0)
+    return ptr;
+
+  if ((newptr = mm_malloc(size)) == NULL)
+    return NULL;
+  memcpy(newptr, ptr, MIN(copysize, size));
+  mm_free(ptr);
+  return newptr;
 }
 
 /*
- * mm_exit - finalize the malloc package.
- * Free all the allocated blocks.
+ * mm_memalign - Allocate size bytes whose address is a multiple of align.
+ *     align must be a power of two. Looks for a free block that holds an
+ *     aligned payload, the fragment in front of the payload stays a free
+ *     block of its own, so alignment costs no padding.
  */
-void mm_exit(void)
+void* mm_memalign(size_t align, size_t size)
 {
- /*
-  char *ptr=heap_listp;
-  
-  while(ptr!=NULL){
-   free(ptr);
-   ptr=NEXT(ptr);
+  size_t asize;
+  char *ptr = NULL, *aptr = NULL;
+  int i;
+
+  if (align <= ALIGNMENT)
+    return mm_malloc(size);
+  if ((align & (align - 1)) != 0 || size == 0)
+    return NULL;
+
+  if ((asize = adjust_size(size)) == 0 || asize > (size_t)-1 - align - 2*DSIZE)
+    return NULL;
+
+  if (asize >= LARGE_MIN) {
+    if ((aptr = large_alloc(size, align)) != NULL && (sample_countdown -= size) < 0)
+      sample_alloc(aptr, size);
+    return aptr;
+  }
+
+  /* Search the segregated lists for a block with room for an aligned payload */
+  for (i = bin_index(asize); i < NBINS && aptr == NULL; i++) {
+    for (ptr = LIST_ROOT(i); ptr != NULL; ptr = PRED_LIST(ptr)) {
+      if ((aptr = aligned_fit(ptr, align, asize)) != NULL)
+        break;
+    }
   }
-  */
-  return;
-}
 
+  /* No fit found, a new block of this size always has one */
+  if (aptr == NULL) {
+    if ((ptr = grow_heap(MAX(asize + align + 2*DSIZE, CHUNKSIZE))) == NULL)
+      return NULL;
+    aptr = aligned_fit(ptr, align, asize);
+  }
 
+  aptr = place_aligned(ptr, aptr, asize);
+
+  if ((sample_countdown -= size) < 0)
+    sample_alloc(aptr, size);
+  return aptr;
+}
 
-//------------------------------------------------------------------------------------------------
 /*
- * extend_heap - extends the heap with a new free block.
+ * mm_usable_size - bytes of payload the block of ptr can hold.
+ *     Includes the slack place() left when the remainder was too small to split.
  */
-static void *extend_heap(size_t words) 
+size_t mm_usable_size(void *ptr)
 {
-    char *ptr;
-    size_t asize;
-    
-    asize = ALIGN(words);
-    
-    if ((long)(ptr = mem_sbrk(asize)) == -1) 
-        return NULL;
-
-    /* Initialize free block header/footer and the epilogue header */
-    PUT(HDRP(ptr), PACK(asize, 0));         /* free block header */
-    PUT(FTRP(ptr), PACK(asize, 0));         /* free block footer */
-    PUT(HDRP(NEXT(ptr)), PACK(0, 1));      /* new epilogue header */
-    insert_node(ptr,asize);
-
-    return coalesce(ptr);
+  if (!ptr) return 0;
+  if (IS_LARGE(ptr))
+    return LARGE_DESC(ptr)->map + LARGE_DESC(ptr)->len - (char *)ptr;
+  return GET_SIZE(HDRP(ptr)) - DSIZE;
 }
 
-/* 
- * place - Place block of asize bytes at start of free block bp 
- *         and split if remainder would be at least minimum block size
+/*
+ * mm_try_expand - Grow the block of ptr in place to hold at least min and
+ *     at most max bytes, by taking all or the front of the free block after
+ *     it. The last block of the heap grows by extending the heap. The block
+ *     never moves. Returns the new usable size, or 0 if the block could not
+ *     grow to min and was left as it was. A min or max too large for any
+ *     block gets 0 as well.
  */
-static void *place(void *ptr, size_t asize)
+size_t mm_try_expand(void *ptr, size_t min, size_t max)
 {
-  size_t csize = GET_SIZE(HDRP(ptr));
-  
-  delete_node(ptr);
-   
-  if(asize >= 100) {
-    // Split block
-    PUT(HDRP(ptr), PACK(csize-asize, 0));
-    PUT(FTRP(ptr), PACK(csize-asize, 0));
-    PUT(HDRP(NEXT(ptr)), PACK(asize, 1));
-    PUT(FTRP(NEXT(ptr)), PACK(asize, 1));
-    insert_node(ptr, csize-asize);
-    return NEXT(ptr);
+  size_t csize, nsize, need, want;
+  unsigned int clean;
+  char *next;
+
+  if (!ptr) return 0;
+  if (IS_LARGE(ptr))   /* a mapping only grows through mm_realloc */
+    return min <= mm_usable_size(ptr) ? mm_usable_size(ptr) : 0;
+  csize = GET_SIZE(HDRP(ptr));
+  if (min <= csize - DSIZE)
+    return csize - DSIZE;
+  if (max < min)
+    max = min;
+
+  if ((need = adjust_size(min)) == 0 || (want = adjust_size(max)) == 0)
+    return 0;
+
+  next = NEXT(ptr);
+  if (GET_SIZE(HDRP(next)) == 0 && !IN_SEGMENT(next)) {
+    /* Same limits as grow_heap, relief leaves ptr the last block */
+    relieve(MAX(need - csize, CHUNKSIZE));
+    if (extend_heap(MAX(need - csize, CHUNKSIZE)) == NULL)
+      return 0;
   }
-  
-  else if((csize-asize) >= 2 * DSIZE) {
-    PUT(HDRP(ptr), PACK(asize,1));
-    PUT(FTRP(ptr), PACK(asize,1));
-    ptr = NEXT(ptr);
-    PUT(HDRP(ptr), PACK(csize-asize,0));
-    PUT(FTRP(ptr), PACK(csize-asize,0));
-    insert_node(ptr, csize-asize);
+  if (GET_ALLOC(HDRP(next)) || csize + GET_SIZE(HDRP(next)) < need)
+    return 0;
+
+  nsize = csize + GET_SIZE(HDRP(next));
+  clean = GET_CLEAN(HDRP(next));
+  delete_node(next);
+  FORGET_BLOCK(next, ptr);
+
+  /* Split off what is not wanted, its other neighbor is allocated */
+  if (want < nsize && (nsize-want) >= 2 * DSIZE) {
+    PUT(HDRP(ptr), PACK(want, 1) | GET_SAMPLED(HDRP(ptr)));
+    PUT(FTRP(ptr), PACK(want, 1));
+    next = NEXT(ptr);
+    PUT(HDRP(next), PACK(nsize-want, 0) | clean);
+    PUT(FTRP(next), PACK(nsize-want, 0));
+    insert_node(next, nsize-want);
   }
-  
-  else{
-      PUT(HDRP(ptr), PACK(csize, 1));
-      PUT(FTRP(ptr), PACK(csize, 1));
+  else {
+    PUT(HDRP(ptr), PACK(nsize, 1) | GET_SAMPLED(HDRP(ptr)));
+    PUT(FTRP(ptr), PACK(nsize, 1));
   }
-  
-  return ptr;
-}
+  NOTE_USED(ptr);
 
+  return GET_SIZE(HDRP(ptr)) - DSIZE;
+}
 
 /*
- * coalesce - boundary tag coalescing. Return ptr to coalesced block
+ * mm_malloc_batch - Allocate n blocks of size bytes into out.
+ *     The blocks are carved side by side from one free block of n times
+ *     the block size, so the lists are searched and updated once for all
+ *     of them. Falls back to mm_malloc if no such block can be had.
+ *     Returns the number of blocks allocated.
+ */
+int mm_malloc_batch(size_t size, int n, void **out)
+{
+  size_t asize, total, csize;
+  unsigned int clean;
+  char *ptr;
+  int k = 0;
+
+  if (size == 0 || n <= 0)
+    return 0;
+
+  if ((asize = adjust_size(size)) == 0)
+    return 0;
+
+  if (asize <= (size_t)-1 / n && (ptr = find_fit(total = asize * n)) != NULL) {
+    csize = GET_SIZE(HDRP(ptr));
+    clean = GET_CLEAN(HDRP(ptr));
+    delete_node(ptr);
+
+    for (k = 0; k < n - 1; k++) {
+      PUT(HDRP(ptr), PACK(asize, 1));
+      PUT(FTRP(ptr), PACK(asize, 1));
+      MARK_LIVE(ptr);
+      out[k] = ptr;
+      ptr = NEXT(ptr);
+    }
+
+    /* The last block takes the remainder unless it can be a block itself */
+    csize -= total - asize;
+    if ((csize-asize) >= 2 * DSIZE) {
+      PUT(HDRP(ptr), PACK(asize, 1));
+      PUT(FTRP(ptr), PACK(asize, 1));
+      out[k++] = ptr;
+      ptr = NEXT(ptr);
+      PUT(HDRP(ptr), PACK(csize-asize, 0) | clean);
+      PUT(FTRP(ptr), PACK(csize-asize, 0));
+      insert_node(ptr, csize-asize);
+    }
+    else {
+      PUT(HDRP(ptr), PACK(csize, 1));
+      PUT(FTRP(ptr), PACK(csize, 1));
+      out[k++] = ptr;
+    }
+    MARK_LIVE(out[n-1]);
+    NOTE_USED(out[n-1]);
+
+    for (k = 0; k < n; k++)
+      if ((sample_countdown -= size) < 0)
+        sample_alloc(out[k], size);
+    return n;
+  }
+
+  for (k = 0; k < n; k++)
+    if ((out[k] = mm_malloc(size)) == NULL)
+      break;
+  return k;
+}
+
+/*
+ * mm_free_batch - Free the n blocks in ptrs.
+ *     ptrs is sorted by address in place, so blocks that are next to each
+ *     other in the heap are merged into one free block and go through
+ *     insert_node and coalesce once per run instead of once per block.
+ */
+void mm_free_batch(void **ptrs, int n)
+{
+  char *ptr, *run;
+  size_t size;
+  int k;
+
+  sort_ptrs(ptrs, n);
+
+  for (k = 0; k < n; k++) {
+    if ((ptr = ptrs[k]) == NULL)
+      continue;
+    if ((k > 0 && ptrs[k-1] == ptr) || !IS_LIVE(ptr))
+      handle_double_free();
+    if (IS_LARGE(ptr)) {
+      mm_free(ptr);
+      continue;
+    }
+
+    /* Collect the run of blocks that follow each other in the heap */
+    run = ptr;
+    size = 0;
+    for (;;) {
+      if (GET_SAMPLED(HDRP(ptr)))
+        sample_free(ptr);
+      if (gl_ranges)
+        remove_range(gl_ranges, ptr);
+      size += GET_SIZE(HDRP(ptr));
+      PUT(HDRP(ptr), PACK(GET_SIZE(HDRP(ptr)), 0));
+      MARK_DEAD(ptr);
+      if (k + 1 >= n || ptrs[k+1] != NEXT(ptr) || !IS_LIVE(NEXT(ptr)))
+        break;
+      ptr = ptrs[++k];
+      FORGET_BLOCK(ptr, run);
+    }
+
+    PUT(HDRP(run), PACK(size, 0));
+    PUT(FTRP(run), PACK(size, 0));
+    insert_node(run, size);
+    release_segment(drop_fences(coalesce(run)));
+  }
+}
+
+/*
+ * mm_mallocx - mm_malloc with flags from mm_ext.h
+ *     MM_LG_ALIGN(la) aligns the payload to 2^la bytes, MM_ZERO zeroes it,
+ *     MM_CACHELINE gives it whole cache lines so no other block shares them,
+ *     and MM_EXACT hands over the block the fit policy picks without
+ *     splitting it if it is less than SPLIT_THRESHOLD bytes too large.
+ *     A larger block is split as by mm_malloc, so nothing big is wasted.
+ */
+void* mm_mallocx(size_t size, int flags)
+{
+  size_t align = (flags & 0x3f) ? (size_t)1 << (flags & 0x3f) : 0;
+  size_t asize;
+  void *ptr;
+
+  if (size == 0)
+    return NULL;
+
+  if (flags & MM_CACHELINE) {
+    if (size > (size_t)-1 - (CACHELINE - 1))
+      return NULL;
+    align = MAX(align, CACHELINE);
+    size = (size + CACHELINE - 1) & ~(size_t)(CACHELINE - 1);
+  }
+
+  if (align > ALIGNMENT) {
+    ptr = mm_memalign(align, size);
+  }
+  else if ((flags & MM_EXACT) && size < LARGE_MIN) {
+    if ((asize = adjust_size(size)) == 0)
+      return NULL;
+
+    /* Grow by just this block when nothing fits */
+    if ((ptr = search_fit(asize)) == NULL && (ptr = grow_heap(asize)) == NULL)
+      return NULL;
+    if (GET_SIZE(HDRP(ptr)) - asize >= SPLIT_THRESHOLD)
+      ptr = place(ptr, asize);
+    else {
+      delete_node(ptr);
+      PUT(HDRP(ptr), PACK(GET_SIZE(HDRP(ptr)), 1));
+      PUT(FTRP(ptr), PACK(GET_SIZE(HDRP(ptr)), 1));
+      MARK_LIVE(ptr);
+      NOTE_USED(ptr);
+    }
+    if ((sample_countdown -= size) < 0)
+      sample_alloc(ptr, size);
+  }
+  else if (flags & MM_ZERO) {
+    return mm_calloc(1, size);
+  }
+  else {
+    ptr = mm_malloc(size);
+  }
+
+  if (ptr != NULL && (flags & MM_ZERO))
+    zero_bytes(ptr, size);
+  return ptr;
+}
+
+/*
+ * mm_sdallocx - mm_free for callers that know the size they allocated.
+ *     size and flags are the ones given to mm_mallocx (or the size given to
+ *     mm_malloc). The list is chosen from them instead of the header. The
+ *     header word is still compared against them, which also catches a double
+ *     free, and any block that does not match, was not split to its size,
+ *     has free neighbors or fences or lies in a segment goes through mm_free.
+ */
+void mm_sdallocx(void *ptr, size_t size, int flags)
+{
+  size_t asize;
+
+  if (!ptr) return;
+
+  if ((flags & MM_CACHELINE) && size > (size_t)-1 - (CACHELINE - 1))
+    size = (size_t)-1;
+  else if (flags & MM_CACHELINE)
+    size = (size + CACHELINE - 1) & ~(size_t)(CACHELINE - 1);
+  asize = adjust_size(size);
+
+  if (asize == 0 || !IS_LIVE(ptr) || GET(HDRP(ptr)) != PACK(asize, 1) || gl_ranges || IN_SEGMENT(ptr) ||
+      !GET_ALLOC((char *)ptr - DSIZE) || !GET_ALLOC((char *)ptr + asize - WSIZE) ||
+      IS_FENCE(PREV(ptr)) || IS_FENCE((char *)ptr + asize)) {
+    mm_free(ptr);
+    return;
+  }
+
+  MARK_DEAD(ptr);
+  PUT(HDRP(ptr), PACK(asize, 0));
+  PUT((char *)ptr + asize - DSIZE, PACK(asize, 0));
+  insert_bin(ptr, asize, bin_index(asize));
+}
+
+/*
+ * mm_halloc - Allocate a relocatable block of size bytes.
+ *     The block is reached through the returned handle and may be moved
+ *     by mm_compact while it is not locked. Returns NULL if out of memory.
+ */
+mm_handle_t mm_halloc(size_t size)
+{
+  struct mm_handle *h;
+  size_t asize;
+  char *ptr;
+  int i;
+
+  if (size == 0 || size > (size_t)-1 - HPAD - ALIGNMENT - DSIZE)
+    return NULL;
+
+  /* Slots live in ordinary blocks, which are never moved */
+  if (GET_PTR(&meta->free_handles) == NULL) {
+    if ((h = mm_malloc(HSLOTS * sizeof(*h))) == NULL)
+      return NULL;
+    for (i = 0; i < HSLOTS; i++) {
+      h[i].ptr = GET_PTR(&meta->free_handles);
+      PUT_PTR(&meta->free_handles, &h[i]);
+    }
+  }
+
+  asize = ALIGN(size + HPAD + DSIZE);
+  if ((ptr = find_fit(asize)) == NULL)
+    return NULL;
+  ptr = place(ptr, asize);
+  PUT(HDRP(ptr), GET(HDRP(ptr)) | MOVABLE_TAG);
+
+  h = (struct mm_handle *)GET_PTR(&meta->free_handles);
+  PUT_PTR(&meta->free_handles, h->ptr);
+  *(struct mm_handle **)ptr = h;
+  h->ptr = ptr + HPAD;
+  h->locks = 0;
+  return h;
+}
+
+/*
+ * mm_hlock - Pin the block of handle h and return its payload.
+ *     Locks nest, the block can move again once every lock is released.
+ */
+void* mm_hlock(mm_handle_t h)
+{
+  h->locks++;
+  return h->ptr;
+}
+
+void mm_hunlock(mm_handle_t h)
+{
+  h->locks--;
+}
+
+/*
+ * mm_hfree - Free the block of handle h and the handle itself.
+ */
+void mm_hfree(mm_handle_t h)
+{
+  if (!h) return;
+  mm_free((char *)h->ptr - HPAD);
+  h->ptr = GET_PTR(&meta->free_handles);
+  PUT_PTR(&meta->free_handles, h);
+}
+
+/*
+ * mm_compact - Slide unlocked handle blocks toward the start of the heap.
+ *     Each free block is swapped with the handle block after it, so the
+ *     free space rises until it meets an ordinary or locked block, where
+ *     it merges with whatever is free there. The walk resumes where the
+ *     last call stopped and does about budget bytes of work, a moved
+ *     block counting its size and a skipped one DSIZE. Once a walk
+ *     reaches the end of the heap the free space above the last fixed
+ *     block is one block, which mm_trim can hand back.
+ *     Returns the number of bytes moved.
+ */
+size_t mm_compact(size_t budget)
+{
+  struct mm_handle *h;
+  size_t fsize, msize, moved = 0, work = 0;
+  char *ptr, *next;
+
+  if ((ptr = GET_PTR(&meta->cursor)) == NULL)
+    ptr = NEXT(heap_listp);
+
+  while (work < budget) {
+    if (GET_SIZE(HDRP(ptr)) == 0) {
+      ptr = NULL;                     /* start over next time */
+      break;
+    }
+    next = NEXT(ptr);
+    if (GET_ALLOC(HDRP(ptr)) || !GET_MOVABLE(HDRP(next)) ||
+        (h = *(struct mm_handle **)next)->locks) {
+      ptr = next;
+      work += DSIZE;
+      continue;
+    }
+
+    /* Move the handle block down over the free block, the free space goes on top */
+    fsize = GET_SIZE(HDRP(ptr));
+    msize = GET_SIZE(HDRP(next));
+    delete_node(ptr);
+    FORGET_BLOCK(next, ptr);
+    MARK_DEAD(next);
+    MARK_LIVE(ptr);
+    memmove(HDRP(ptr), HDRP(next), msize);
+    h->ptr = ptr + HPAD;
+    NOTE_USED(ptr);
+
+    next = NEXT(ptr);
+    PUT(HDRP(next), PACK(fsize, 0));
+    PUT(FTRP(next), PACK(fsize, 0));
+    insert_node(next, fsize);
+    ptr = coalesce(next);
+    moved += msize;
+    work += msize;
+  }
+
+  /* An epilogue is no block, mm_trim may move it */
+  if (ptr != NULL && GET_SIZE(HDRP(ptr)) == 0)
+    ptr = NULL;
+  PUT_PTR(&meta->cursor, ptr);
+  return moved;
+}
+
+/*
+ * mm_trim - Give the free space at the top of the heap back to memlib,
+ *     keeping at least pad bytes of it. Only with MM_SBRK_SHRINKS, the lab's
+ *     mem_sbrk cannot lower the break. Returns the number of bytes released.
+ */
+size_t mm_trim(size_t pad)
+{
+#ifdef MM_SBRK_SHRINKS
+  char *end = (char *)mem_heap_hi() + 1;
+  char *ptr = PREV(end);                 /* last block */
+  size_t size = GET_SIZE(HDRP(ptr));
+  size_t keep = MAX(ALIGN(pad + DSIZE), 2 * DSIZE);
+  size_t release, brk;
+
+  if (GET_ALLOC(HDRP(ptr)) || size <= keep)
+    return 0;
+  release = MIN(size - keep, (size_t)INT_MAX & ~(ALIGNMENT-1));
+
+  /* Leave the break on a page boundary so no page is left half used */
+  brk = (end - heap_base - release + TRIM_UNIT - 1) & ~(size_t)(TRIM_UNIT - 1);
+  release = end - heap_base - brk;
+  if (brk >= (size_t)(end - heap_base) || release < CHUNKSIZE)
+    return 0;
+
+  delete_node(ptr);
+  if ((long)mem_sbrk(-(int)release) == -1) {
+    insert_node(ptr, size);
+    return 0;
+  }
+  footprint -= release;
+  size -= release;
+  PUT(HDRP(ptr), PACK(size, 0) | GET_CLEAN(HDRP(ptr)));
+  PUT(FTRP(ptr), PACK(size, 0));
+  PUT(HDRP(NEXT(ptr)), PACK(0, 1));      /* new epilogue header */
+  insert_node(ptr, size);
+
+  /* The break clears what it leaves behind */
+  if (heap_base + meta->zero_hwm > (char *)FTRP(ptr))
+    meta->zero_hwm = (char *)FTRP(ptr) - heap_base;
+  return release;
+#else
+  (void)pad;
+  return 0;
+#endif
+}
+
+/*
+ * mm_purge - Hand the pages inside large dirty free blocks back to memlib.
+ *     A purged block reads as zero, so it becomes clean and is not purged
+ *     again until it has been used. Pages are released in TRIM_UNITs and
+ *     the rest of the block is zeroed by hand. Stops after about budget
+ *     bytes of work, a purged block counting its size and a skipped one
+ *     DSIZE. Only with MM_SBRK_ZEROES, where memlib_os.c is the heap.
+ *     Returns the number of bytes released.
+ */
+size_t mm_purge(size_t budget)
+{
+#ifdef MM_SBRK_ZEROES
+  size_t released = 0, work = 0;
+  char *ptr, *lo, *hi;
+  int i;
+
+  /* Largest blocks first, they have the most whole pages */
+  for (i = NBINS - 1; i >= bin_index(PURGE_MIN) && work < budget; i--) {
+    for (ptr = LIST_ROOT(i); ptr != NULL && work < budget; ptr = PRED_LIST(ptr)) {
+      work += DSIZE;
+      if (GET_CLEAN(HDRP(ptr)) || GET_SIZE(HDRP(ptr)) < PURGE_MIN)
+        continue;
+      lo = heap_base + ((ptr + DSIZE - heap_base + TRIM_UNIT - 1) & ~(size_t)(TRIM_UNIT - 1));
+      hi = heap_base + (((char *)FTRP(ptr) - heap_base) & ~(size_t)(TRIM_UNIT - 1));
+      if (hi <= lo || mem_purge(lo, hi) != 0)
+        continue;
+      memset(ptr + DSIZE, 0, lo - (ptr + DSIZE));
+      memset(hi, 0, (char *)FTRP(ptr) - hi);
+      PUT(HDRP(ptr), GET(HDRP(ptr)) | CLEAN_TAG);
+      released += hi - lo;
+      work += GET_SIZE(HDRP(ptr));
+    }
+  }
+  return released;
+#else
+  (void)budget;
+  return 0;
+#endif
+}
+
+/*
+ * mm_check - Check the next budget blocks of the heap, resuming where the
+ *     last call stopped and starting over at the end. Each block has to
+ *     lie in its region with matching header and footer. A free block
+ *     must not be followed by another, and its list neighbors must link
+ *     back to it, be free, be in the same list and keep the list's order.
+ *     Whatever corrupts a list shows up at the blocks next to the damage,
+ *     so a full round finds it without walking the lists. Returns 0, or
+ *     -1 after printing what is wrong to stderr.
+ */
+int mm_check(size_t budget)
+{
+  char *ptr, *end;
+  int r = 0;
+
+  if ((ptr = GET_PTR(&meta->check)) == NULL)
+    ptr = first_block(0);
+#ifdef MM_SEGMENTS
+  if (IN_SEGMENT(ptr) && (r = seg_of(ptr) + 1) > 0)
+    end = segs[r-1].start + segs[r-1].size;
+  else
+#endif
+  end = (char *)mem_heap_hi() + 1;
+  if (GET_SIZE(HDRP(ptr)) == 0)           /* no blocks at all */
+    return 0;
+
+  for (; budget > 0; budget--) {
+    if (check_block(ptr, end) < 0) {
+      meta->check = 0;
+      return -1;
+    }
+    ptr = NEXT(ptr);
+
+    /* The cursor never rests on an epilogue, which mm_trim may move */
+    if (GET_SIZE(HDRP(ptr)) == 0) {
+      if ((ptr = first_block(++r)) == NULL)
+        ptr = first_block(r = 0);
+#ifdef MM_SEGMENTS
+      end = r > 0 ? segs[r-1].start + segs[r-1].size : (char *)mem_heap_hi() + 1;
+#endif
+    }
+  }
+  PUT_PTR(&meta->check, ptr);
+  return 0;
+}
+
+/*
+ * mm_set_check_rate - have every'th call of mm_malloc or mm_free run
+ *     mm_check on budget blocks, and abort if it fails. 0 turns it off.
+ */
+void mm_set_check_rate(long every, size_t budget)
+{
+  check_every = every;
+  check_budget = budget;
+  check_countdown = every > 0 ? every : LONG_MAX;
+}
+
+static void check_tick(void)
+{
+  check_countdown = check_every;
+  if (mm_check(check_budget) < 0)
+    abort();
+}
+
+/*
+ * mm_set_limits - cap the footprint. Growing it past soft first runs the
+ *     pressure handler, then mm_purge and mm_trim; growing it past hard
+ *     fails right away, so mm_malloc returns NULL before the OS is asked.
+ *     0 is no limit.
+ */
+void mm_set_limits(size_t soft, size_t hard)
+{
+  soft_limit = soft;
+  hard_limit = hard > 0 ? hard : (size_t)-1;
+  pressure_mark = soft;
+}
+
+/*
+ * mm_set_pressure_handler - have fn(over, arg) called when the heap is
+ *     about to grow over bytes past the soft limit. fn may free blocks,
+ *     and allocate too, but does not start relief again.
+ */
+void mm_set_pressure_handler(mm_pressure_fn fn, void *arg)
+{
+  pressure_fn = fn;
+  pressure_arg = arg;
+}
+
+size_t mm_footprint(void)
+{
+  return footprint;
+}
+
+int mm_in_pressure_handler(void)
+{
+  return relieving;
+}
+
+/*
+ * relieve - before the footprint grows by grow bytes past the soft limit,
+ *     let the application shed memory and purge and trim the heap. Relief
+ *     then waits until the footprint has grown another eighth of the soft
+ *     limit, so a heap that stays over it does not run it on every call.
+ *     Returns whether it ran.
+ */
+static int relieve(size_t grow)
+{
+  size_t want = footprint + grow;
+
+  if (grow > (size_t)-1 / 2)            /* fails anyway, mappings are smaller */
+    return 0;
+  if (soft_limit == 0 || want <= soft_limit) {
+    pressure_mark = soft_limit;
+    return 0;
+  }
+  if (want <= pressure_mark || relieving)
+    return 0;
+
+  relieving = 1;
+  if (pressure_fn != NULL)
+    pressure_fn(want - soft_limit, pressure_arg);
+  mm_purge((size_t)-1);
+  mm_trim(0);
+  relieving = 0;
+  pressure_mark = MAX(footprint + grow, soft_limit) + soft_limit / 8;
+  return 1;
+}
+
+/*
+ * over_hard - whether growing the footprint by grow bytes passes the hard limit
+ */
+static int over_hard(size_t grow)
+{
+  return footprint > hard_limit || grow > hard_limit - footprint;
+}
+
+/*
+ * check_fail - report what is wrong with the block at ptr
+ */
+static int check_fail(char *ptr, const char *what)
+{
+  fprintf(stderr, "mm_check: %s, block at heap offset %lu\n", what,
+          (unsigned long)(ptr - heap_base));
+  return -1;
+}
+
+/*
+ * check_block - check block ptr of a region ending at end
+ */
+static int check_block(char *ptr, char *end)
+{
+  size_t size = GET_SIZE(HDRP(ptr));
+  char *pred, *succ;
+  int i;
+
+  if (size < 2 * DSIZE || (size & (ALIGNMENT-1)) || size > (size_t)(end - ptr))
+    return check_fail(ptr, "size out of range");
+  if (GET_SIZE(FTRP(ptr)) != size || GET_ALLOC(FTRP(ptr)) != GET_ALLOC(HDRP(ptr)))
+    return check_fail(ptr, "header and footer differ");
+  if (!IS_LIVE(ptr) != !GET_ALLOC(HDRP(ptr)))
+    return check_fail(ptr, "start bit does not match the header");
+  if (GET_ALLOC(HDRP(ptr)))
+    return 0;
+
+  if (!GET_ALLOC(HDRP(NEXT(ptr))))
+    return check_fail(ptr, "free block not coalesced with the next one");
+
+  /* The list runs from its root through the pred links */
+  i = bin_index(size);
+  pred = PRED_LIST(ptr);
+  succ = SUCC_LIST(ptr);
+  if (succ == NULL) {
+    if (LIST_ROOT(i) != ptr)
+      return check_fail(ptr, "free block without a successor is not the root of its list");
+  }
+  else {
+    if (check_link(succ) < 0)
+      return check_fail(ptr, "successor link out of the heap");
+    if (PRED_LIST(succ) != ptr)
+      return check_fail(ptr, "successor does not link back");
+    if (GET_ALLOC(HDRP(succ)) || bin_index(GET_SIZE(HDRP(succ))) != i)
+      return check_fail(ptr, "successor is not a free block of the same list");
+    if (ORDER(POLICY) == MM_ORDER_ADDR ? succ > ptr : GET_SIZE(HDRP(succ)) > size)
+      return check_fail(ptr, "list out of order");
+  }
+  if (pred != NULL) {
+    if (check_link(pred) < 0)
+      return check_fail(ptr, "predecessor link out of the heap");
+    if (SUCC_LIST(pred) != ptr)
+      return check_fail(ptr, "predecessor does not link back");
+  }
+#ifdef MM_BIN_INDEX
+  if (ix_find(i, ptr) < 0)
+    return check_fail(ptr, "free block missing from the index of its list");
+#endif
+  return 0;
+}
+
+/*
+ * check_link - whether list link ptr can be a block, before reading it
+ */
+static int check_link(char *ptr)
+{
+  if (((unsigned long)ptr & (ALIGNMENT-1)) != 0)
+    return -1;
+  if (ptr > heap_listp && ptr < (char *)mem_heap_hi() + 1)
+    return 0;
+#ifdef MM_SEGMENTS
+  if (IN_SEGMENT(ptr) && seg_of(ptr) >= 0)
+    return 0;
+#endif
+  return -1;
+}
+
+/*
+ * mm_exit - finalize the malloc package.
+ * Free all the allocated blocks.
+ */
+void mm_exit(void)
+{
+ /*
+  char *ptr=heap_listp;
+  
+  while(ptr!=NULL){
+   free(ptr);
+   ptr=NEXT(ptr);
+  }
+  */
+  return;
+}
+
+
+
+//------------------------------------------------------------------------------------------------
+/*
+ * adjust_size - size of the block for a payload of size bytes, with room
+ *     for header and footer and aligned, at least the minimum block.
+ *     0 if that does not fit a size_t.
+ */
+static size_t adjust_size(size_t size)
+{
+  if (size <= DSIZE)
+    return 2 * DSIZE;
+  if (size > (size_t)-1 - ALIGNMENT - DSIZE)
+    return 0;
+  return ALIGN(size + DSIZE);
+}
+
+/*
+ * extend_heap - extends the heap with a new free block.
+ */
+static void *extend_heap(size_t words) 
+{
+    char *ptr;
+    size_t asize;
+    
+    asize = ALIGN(words);
+
+    /* mem_sbrk takes an int */
+    if (asize > (size_t)INT_MAX || over_hard(asize) || (long)(ptr = mem_sbrk(asize)) == -1)
+        return NULL;
+    footprint += asize;
+
+    /* Initialize free block header/footer and the epilogue header */
+    PUT(HDRP(ptr), PACK(asize, 0) | CLEAN_TAG); /* free block header, fresh memory is zero */
+    PUT(FTRP(ptr), PACK(asize, 0));         /* free block footer */
+    PUT(HDRP(NEXT(ptr)), PACK(0, 1));      /* new epilogue header */
+    insert_node(ptr,asize);
+
+    return coalesce(ptr);
+}
+
+/*
+ * search_fit - find a free block of at least asize bytes.
+ *     Search throught the segregated_free_list, NULL if no block fits.
+ */
+static void *search_fit(size_t asize)
+{
+  void *ptr=NULL;
+  int i;
+
+  for (i = bin_index(asize); i < NBINS; i++) {
+      if (LIST_ROOT(i) != NULL && (ptr = bin_fit(i, asize)) != NULL)
+          break;
+  }
+  if (FIT(POLICY) == MM_FIT_NEXT && ptr != NULL)
+      PUT_PTR(&meta->rover, ptr);   /* delete_node moves it on to the next block */
+  return ptr;
+}
+
+/*
+ * bin_fit - pick a block of at least asize bytes from list i by the fit
+ *     policy, NULL if the list has none.
+ */
+#ifdef MM_BIN_INDEX
+static char *bin_fit(int i, size_t asize)
+{
+  unsigned int *sizes = IX_SIZES(i), *offs = IX_OFFS(i);
+  unsigned int more = BOUND(POLICY);
+  int n = IX_COUNT(i), j, k, best = -1;
+  char *start;
+
+  /* Next fit goes on from the rover when it is in this list, wrapping around */
+  if (FIT(POLICY) == MM_FIT_NEXT && (start = GET_PTR(&meta->rover)) != NULL &&
+      bin_index(GET_SIZE(HDRP(start))) == i && (k = ix_find(i, start)) >= 0) {
+    if ((j = ix_fit(i, 0, k + 1, asize)) < 0)
+      j = ix_fit(i, k + 1, n, asize);
+    return j < 0 ? NULL : heap_base + offs[j];
+  }
+
+  /* First fit, which in a list sorted by size is also the best */
+  if (FIT(POLICY) == MM_FIT_FIRST || FIT(POLICY) == MM_FIT_NEXT || ORDER(POLICY) == MM_ORDER_SIZE) {
+    j = ix_fit(i, 0, n, asize);
+    return j < 0 ? NULL : heap_base + offs[j];
+  }
+
+  /* Best fit looks at the whole list, good fit stops after more fits */
+  for (k = n; (j = ix_fit(i, 0, k, asize)) >= 0; k = j) {
+    if (best < 0 || sizes[j] < sizes[best])
+      best = j;
+    if (sizes[best] == asize || (FIT(POLICY) != MM_FIT_BEST && more-- == 0))
+      break;
+  }
+  return best < 0 ? NULL : heap_base + offs[best];
+}
+#else
+static char *bin_fit(int i, size_t asize)
+{
+  char *ptr = LIST_ROOT(i), *best = NULL, *start;
+  unsigned int more = BOUND(POLICY);
+
+  /* Next fit goes on from the rover when it is in this list, wrapping around */
+  if (FIT(POLICY) == MM_FIT_NEXT && (start = GET_PTR(&meta->rover)) != NULL &&
+      bin_index(GET_SIZE(HDRP(start))) == i) {
+    for (ptr = start; ptr != NULL; ptr = PRED_LIST(ptr))
+      if (GET_SIZE(HDRP(ptr)) >= asize)
+        return ptr;
+    for (ptr = LIST_ROOT(i); ptr != start; ptr = PRED_LIST(ptr))
+      if (GET_SIZE(HDRP(ptr)) >= asize)
+        return ptr;
+    return NULL;
+  }
+
+  /* First fit, which in a list sorted by size is also the best */
+  if (FIT(POLICY) == MM_FIT_FIRST || FIT(POLICY) == MM_FIT_NEXT || ORDER(POLICY) == MM_ORDER_SIZE) {
+    while (ptr != NULL && asize > GET_SIZE(HDRP(ptr)))
+      ptr = PRED_LIST(ptr);
+    return ptr;
+  }
+
+  /* Best fit looks at the whole list, good fit stops after more fits */
+  for (; ptr != NULL; ptr = PRED_LIST(ptr)) {
+    if (GET_SIZE(HDRP(ptr)) < asize)
+      continue;
+    if (best == NULL || GET_SIZE(HDRP(ptr)) < GET_SIZE(HDRP(best)))
+      best = ptr;
+    if (GET_SIZE(HDRP(best)) == asize || (FIT(POLICY) != MM_FIT_BEST && more-- == 0))
+      break;
+  }
+  return best;
+}
+#endif
+
+/*
+ * find_fit - find a free block of at least asize bytes, extend the heap if no block fits.
+ */
+static void *find_fit(size_t asize)
+{
+  void *ptr;
+
+  /* No fit found. Get more memory by extending */
+  if ((ptr = search_fit(asize)) == NULL)
+    ptr = grow_heap(MAX(asize,CHUNKSIZE));
+  return ptr;
+}
+
+#ifdef MM_SEGMENTS
+/*
+ * seg_of - index of the segment holding ptr, -1 if ptr is not in one
+ */
+static int seg_of(char *ptr)
+{
+  int lo = 0, hi = nsegs - 1, mid;
+
+  while (lo <= hi) {
+    mid = (lo + hi) / 2;
+    if (ptr < segs[mid].start)
+      hi = mid - 1;
+    else if (ptr >= segs[mid].start + segs[mid].size)
+      lo = mid + 1;
+    else
+      return mid;
+  }
+  return -1;
+}
+
+/*
+ * new_segment - map a segment with a free block of at least asize bytes
+ *     and return that block, NULL if memlib has no room for it.
+ */
+static void *new_segment(size_t asize)
+{
+  size_t size;
+  char *seg, *ptr;
+  int i;
+
+  /* The block size has to fit its header */
+  if (nsegs == SEG_MAX || asize > (size_t)UINT_MAX - 2*DSIZE - SEG_UNIT)
+    return NULL;
+  size = (asize + 2*DSIZE + SEG_UNIT - 1) & ~(size_t)(SEG_UNIT - 1);
+  if (over_hard(size) || (seg = mem_map(size)) == NULL)
+    return NULL;
+  footprint += size;
+
+  for (i = nsegs++; i > 0 && segs[i-1].start > seg; i--)
+    segs[i] = segs[i-1];
+  segs[i].start = seg;
+  segs[i].size = size;
+  seg_floor = segs[0].start;
+
+  PUT(seg, 0);                                   /* alignment padding */
+  PUT(seg + (1*WSIZE), PACK(DSIZE, 1));          /* prologue header */
+  PUT(seg + (2*WSIZE), PACK(DSIZE, 1));          /* prologue footer */
+  ptr = seg + 2*DSIZE;
+  PUT(HDRP(ptr), PACK(size - 2*DSIZE, 0) | CLEAN_TAG);
+  PUT(FTRP(ptr), PACK(size - 2*DSIZE, 0));
+  PUT(HDRP(NEXT(ptr)), PACK(0, 1));              /* epilogue header */
+  insert_node(ptr, size - 2*DSIZE);
+  return ptr;
+}
+#endif
+
+/*
+ * grow_heap - get a free block of at least asize bytes from memlib.
+ *     Extends the heap, except that with MM_SEGMENTS large blocks and
+ *     blocks the break has no room for go in a new segment.
+ */
+static void *grow_heap(size_t asize)
+{
+  void *ptr;
+
+  /* Relief may have freed a block that fits */
+  if (relieve(asize) && (ptr = search_fit(asize)) != NULL)
+    return ptr;
+#ifdef MM_SEGMENTS
+  if (asize < SEG_THRESHOLD && (ptr = extend_heap(asize)) != NULL)
+    return ptr;
+  return new_segment(asize);
+#else
+  return extend_heap(asize);
+#endif
+}
+
+/*
+ * first_block - first block of region r, the heap being region 0 and its
+ *     segments 1 on, NULL past the last region. Each region ends in an epilogue.
+ */
+static char *first_block(int r)
+{
+  if (r == 0)
+    return NEXT(heap_listp);
+#ifdef MM_SEGMENTS
+  if (r <= nsegs)
+    return segs[r-1].start + 2*DSIZE;
+#endif
+  return NULL;
+}
+
+/*
+ * release_segment - give the segment back to memlib if the free block ptr
+ *     is all there is in it.
+ */
+static void release_segment(char *ptr)
+{
+#ifdef MM_SEGMENTS
+  int i;
+
+  if (!IN_SEGMENT(ptr) || GET(HDRP(ptr) - WSIZE) != PACK(DSIZE, 1) ||
+      GET(HDRP(NEXT(ptr))) != PACK(0, 1) || (i = seg_of(ptr)) < 0)
+    return;
+
+  delete_node(ptr);
+  if (GET_PTR(&meta->check) == ptr)
+    meta->check = 0;
+  mem_unmap(segs[i].start, segs[i].size);
+  footprint -= segs[i].size;
+  for (nsegs--; i < nsegs; i++)
+    segs[i] = segs[i+1];
+  seg_floor = nsegs > 0 ? segs[0].start : (char *)-1;
+#else
+  (void)ptr;
+#endif
+}
+
+/*
+ * large_alloc - map a large block of size bytes with its payload aligned
+ *     to align, NULL if memlib cannot.
+ */
+static void *large_alloc(size_t size, size_t align)
+{
+#ifdef MM_LARGE
+  size_t len, page = mem_pagesize();
+  char *map, *ptr;
+  large_t *d;
+
+  if (size > (size_t)-1 / 2 - LARGE_PAD - align - page)
+    return NULL;
+  len = size + LARGE_PAD + (align > ALIGNMENT ? align : 0);
+  len = (len + page - 1) & ~(page - 1);
+  relieve(len);
+  if (over_hard(len) || (map = mem_map_large(len)) == NULL)
+    return NULL;
+  footprint += len;
+
+  ptr = (char *)(((unsigned long)map + LARGE_PAD + align - 1) & ~(unsigned long)(align - 1));
+  d = LARGE_DESC(ptr);
+  d->map = map;
+  d->len = len;
+  d->prev = NULL;
+  if ((d->next = large_list) != NULL)
+    large_list->prev = d;
+  large_list = d;
+  PUT(HDRP(ptr), LARGE_TAG);
+  return ptr;
+#else
+  (void)size;
+  (void)align;
+  return NULL;
+#endif
+}
+
+/*
+ * large_resize - resize the large block ptr to size bytes by remapping it,
+ *     which may move it. NULL if memlib cannot, or if ptr was aligned by
+ *     mm_memalign, and then the block is left as it was.
+ */
+static void *large_resize(void *ptr, size_t size)
+{
+#ifdef MM_LARGE
+  size_t len, old, page = mem_pagesize();
+  large_t *d = LARGE_DESC(ptr);
+  char *map;
+
+  if ((char *)ptr != d->map + LARGE_PAD || size > (size_t)-1 / 2 - LARGE_PAD - page)
+    return NULL;
+  len = (size + LARGE_PAD + page - 1) & ~(page - 1);
+  if ((old = d->len) < len) {
+    relieve(len - old);
+    if (over_hard(len - old))
+      return NULL;
+  }
+  if ((map = mem_remap_large(d->map, old, len)) == NULL)
+    return NULL;
+  footprint = footprint - old + len;
+
+  /* The descriptor moved along with the pages, relink it */
+  if (map + LARGE_PAD != (char *)ptr)
+    sample_free(ptr);
+  d = (large_t *)map;
+  d->map = map;
+  d->len = len;
+  if (d->prev != NULL)
+    d->prev->next = d;
+  else
+    large_list = d;
+  if (d->next != NULL)
+    d->next->prev = d;
+  return map + LARGE_PAD;
+#else
+  (void)ptr;
+  (void)size;
+  return NULL;
+#endif
+}
+
+/*
+ * large_free - give the mapping of large block ptr back to memlib
+ */
+static void large_free(void *ptr)
+{
+#ifdef MM_LARGE
+  large_t *d = LARGE_DESC(ptr);
+
+  if (d->prev != NULL)
+    d->prev->next = d->next;
+  else
+    large_list = d->next;
+  if (d->next != NULL)
+    d->next->prev = d->prev;
+  footprint -= d->len;
+  mem_unmap_large(d->map, d->len);
+#else
+  (void)ptr;
+#endif
+}
+
+#ifdef MM_FREE_CHECK
+/*
+ * is_live - whether ptr is the payload of an allocated block. Large blocks
+ *     lie outside the window and are looked up in their list.
+ */
+static int is_live(char *ptr)
+{
+#ifdef MM_LARGE
+  large_t *d;
+#endif
+  size_t off = (size_t)(ptr - heap_base);
+
+  if (off < live_span)
+    return off % LIVE_GRAIN == 0 && (LIVE_WORD(ptr) & LIVE_MASK(ptr)) != 0;
+#ifdef MM_LARGE
+  for (d = large_list; d != NULL; d = d->next)
+    if ((char *)d + LARGE_PAD == ptr)
+      return 1;
+#endif
+  return 0;
+}
+#endif
+
+/* 
+ * place - Place block of asize bytes at start of free block bp 
+ *         and split if remainder would be at least minimum block size
+ */
+static void *place(void *ptr, size_t asize)
+{
+  size_t csize = GET_SIZE(HDRP(ptr));
+  unsigned int clean = GET_CLEAN(HDRP(ptr)); // the remainder stays as clean as the block
+  
+  delete_node(ptr);
+   
+  if((csize-asize) < 2 * DSIZE) {
+    // Remainder too small to be a block, hand over the whole block
+    PUT(HDRP(ptr), PACK(csize, 1));
+    PUT(FTRP(ptr), PACK(csize, 1));
+  }
+
+  else if(SPLIT(POLICY) == MM_SPLIT_HIGH || (SPLIT(POLICY) == MM_SPLIT_SIZE && asize >= SPLIT_THRESHOLD)) {
+    // Split block, the allocated part at the end
+    PUT(HDRP(ptr), PACK(csize-asize, 0) | clean);
+    PUT(FTRP(ptr), PACK(csize-asize, 0));
+    PUT(HDRP(NEXT(ptr)), PACK(asize, 1));
+    PUT(FTRP(NEXT(ptr)), PACK(asize, 1));
+    insert_node(ptr, csize-asize);
+    ptr = NEXT(ptr);
+  }
+  
+  else {
+    PUT(HDRP(ptr), PACK(asize,1));
+    PUT(FTRP(ptr), PACK(asize,1));
+    ptr = NEXT(ptr);
+    PUT(HDRP(ptr), PACK(csize-asize,0) | clean);
+    PUT(FTRP(ptr), PACK(csize-asize,0));
+    insert_node(ptr, csize-asize);
+    ptr = PREV(ptr);
+  }
+  
+  MARK_LIVE(ptr);
+  NOTE_USED(ptr);
+  return ptr;
+}
+
+
+/*
+ * aligned_fit - payload address in free block ptr that is a multiple of align
+ *     and has room for asize bytes, NULL if there is none. Anything in front
+ *     of it must be big enough to stay a free block.
+ */
+static char *aligned_fit(char *ptr, size_t align, size_t asize)
+{
+  char *aptr = (char *)(((unsigned long)ptr + align - 1) & ~(unsigned long)(align - 1));
+
+  if (aptr != ptr && (size_t)(aptr - ptr) < 2 * DSIZE)
+    aptr += align;
+  if ((size_t)(aptr - ptr) + asize > GET_SIZE(HDRP(ptr)))
+    return NULL;
+  return aptr;
+}
+
+/*
+ * place_aligned - Place block of asize bytes at aptr inside free block ptr.
+ *     The leading fragment and a remainder of at least minimum block size
+ *     are split off as free blocks. Their other neighbors are allocated
+ *     since ptr was coalesced, so they go straight back to the lists.
+ */
+static void *place_aligned(char *ptr, char *aptr, size_t asize)
+{
+  size_t csize = GET_SIZE(HDRP(ptr));
+  size_t lead = aptr - ptr;
+  unsigned int clean = GET_CLEAN(HDRP(ptr));
+
+  delete_node(ptr);
+
+  if (lead > 0) {
+    PUT(HDRP(ptr), PACK(lead, 0) | clean);
+    PUT(FTRP(ptr), PACK(lead, 0));
+    insert_node(ptr, lead);
+    csize -= lead;
+  }
+
+  if ((csize-asize) >= 2 * DSIZE) {
+    PUT(HDRP(aptr), PACK(asize, 1));
+    PUT(FTRP(aptr), PACK(asize, 1));
+    ptr = NEXT(aptr);
+    PUT(HDRP(ptr), PACK(csize-asize, 0) | clean);
+    PUT(FTRP(ptr), PACK(csize-asize, 0));
+    insert_node(ptr, csize-asize);
+  }
+  else {
+    PUT(HDRP(aptr), PACK(csize, 1));
+    PUT(FTRP(aptr), PACK(csize, 1));
+  }
+
+  MARK_LIVE(aptr);
+  NOTE_USED(aptr);
+  return aptr;
+}
+
+
+/*
+ * coalesce - boundary tag coalescing. Return ptr to coalesced block
  */
 static void *coalesce(void *ptr) 
 {
-    size_t prev_alloc = GET_ALLOC(FTRP(PREV(ptr)));
-    size_t next_alloc = GET_ALLOC(HDRP(NEXT(ptr)));
+    char *prev = PREV(ptr);
+    char *next = NEXT(ptr);
+    size_t prev_alloc = GET_ALLOC(FTRP(prev));
+    size_t next_alloc = GET_ALLOC(HDRP(next));
     size_t size = GET_SIZE(HDRP(ptr));
+    unsigned int clean = GET_CLEAN(HDRP(ptr)); /* merged block is clean if all parts are */
+
+    /* The seam in front of a clean part is zeroed even if the merged block is not,
+       as that part may lie above zero_hwm, where calloc does not zero */
 
     if (prev_alloc && next_alloc) {            /* Case 1: Neighbors both allocated */
         return ptr;
@@ -329,9 +2241,13 @@ static void *coalesce(void *ptr)
 
     else if (prev_alloc && !next_alloc) {      /* Case 2: Only the previous is allocated*/
         delete_node(ptr);
-        delete_node(NEXT(ptr));
-        size += GET_SIZE(HDRP(NEXT(ptr)));
-        PUT(HDRP(ptr), PACK(size,0));
+        delete_node(next);
+        size += GET_SIZE(HDRP(next));
+        if (GET_CLEAN(HDRP(next)))
+            ZERO_SEAM(next);
+        clean &= GET_CLEAN(HDRP(next));
+        FORGET_BLOCK(next, ptr);
+        PUT(HDRP(ptr), PACK(size,0) | clean);
         PUT(FTRP(ptr), PACK(size,0));
         insert_node(ptr, size);
         return ptr;
@@ -339,44 +2255,183 @@ static void *coalesce(void *ptr)
 
     else if (!prev_alloc && next_alloc) {      /* Case 3: Only the next is allocated */
         delete_node(ptr);
-        delete_node(PREV(ptr));
-        size += GET_SIZE(HDRP(PREV(ptr)));
-        PUT(FTRP(ptr), PACK(size, 0));
-        PUT(HDRP(PREV(ptr)), PACK(size, 0));
-        insert_node(PREV(ptr), size);
-        return (PREV(ptr));
+        delete_node(prev);
+        size += GET_SIZE(HDRP(prev));
+        if (clean)
+            ZERO_SEAM(ptr);
+        clean &= GET_CLEAN(HDRP(prev));
+        FORGET_BLOCK(ptr, prev);
+        PUT(HDRP(prev), PACK(size, 0) | clean);
+        PUT(FTRP(prev), PACK(size, 0));
+        insert_node(prev, size);
+        return prev;
     }
 
     else {                                     /* Case 4: Neither are allocated */
         delete_node(ptr);
-        delete_node(PREV(ptr));
-        delete_node(NEXT(ptr));
-        size += GET_SIZE(HDRP(PREV(ptr))) + GET_SIZE(FTRP(NEXT(ptr)));
-        PUT(HDRP(PREV(ptr)), PACK(size, 0));
-        PUT(FTRP(NEXT(ptr)), PACK(size, 0));
-        insert_node(PREV(ptr), size);
-        return (PREV(ptr));
+        delete_node(prev);
+        delete_node(next);
+        size += GET_SIZE(HDRP(prev)) + GET_SIZE(HDRP(next));
+        if (clean)
+            ZERO_SEAM(ptr);
+        if (GET_CLEAN(HDRP(next)))
+            ZERO_SEAM(next);
+        clean &= GET_CLEAN(HDRP(prev)) & GET_CLEAN(HDRP(next));
+        FORGET_BLOCK(ptr, prev);
+        FORGET_BLOCK(next, prev);
+        PUT(HDRP(prev), PACK(size, 0) | clean);
+        PUT(FTRP(prev), PACK(size, 0));
+        insert_node(prev, size);
+        return prev;
     }
 }
 
+/*
+ * drop_fences - free the prewarm fences next to free block ptr, so it merges
+ *     with the blocks behind them, and return the merged block. Only the
+ *     nearest fence on each side goes, the ones further out stay.
+ */
+static void *drop_fences(char *ptr)
+{
+    char *fence;
 
-static void insert_node(void *ptr, size_t size) {
+    if (IS_FENCE(NEXT(ptr))) {
+        fence = NEXT(ptr);
+        MARK_DEAD(fence);
+        PUT(HDRP(fence), PACK(2 * DSIZE, 0) | GET_CLEAN(FTRP(fence)));
+        PUT(FTRP(fence), PACK(2 * DSIZE, 0));
+        insert_node(fence, 2 * DSIZE);
+        ptr = coalesce(fence);
+    }
+    if (IS_FENCE(PREV(ptr))) {
+        fence = PREV(ptr);
+        MARK_DEAD(fence);
+        PUT(HDRP(fence), PACK(2 * DSIZE, 0) | GET_CLEAN(FTRP(fence)));
+        PUT(FTRP(fence), PACK(2 * DSIZE, 0));
+        insert_node(fence, 2 * DSIZE);
+        ptr = coalesce(fence);
+    }
+    return ptr;
+}
+
+/*
+ * bin_index - segregated list holding free blocks of size bytes.
+ *     List i keeps sizes in [2^i, 2^(i+1)), the last one everything larger.
+ *     With BIN_STEP_BITS each power of two is split further by the bits
+ *     below its leading one, so the lists keep their order by size.
+ */
+static int bin_index(size_t size)
+{
     int i = 0;
-    void *search_ptr = ptr;
-    void *insert_ptr = NULL;
-    
-    /* Select segregated list */ 
-    while ((i < 24) && (size > 1)) {
-        size >>= 1;
+    size_t s = size;
+
+    while ((i < NBINS - 1) && (s > 1)) {
+        s >>= 1;
+        i++;
+    }
+#if BIN_STEP_BITS > 0
+    while (s > 1) {
+        s >>= 1;
         i++;
     }
+    if (i >= BIN_STEP_BITS)
+        i = (i << BIN_STEP_BITS) |
+            (int)((size >> (i - BIN_STEP_BITS)) & ((1 << BIN_STEP_BITS) - 1));
+#endif
+    return MIN(i, NBINS - 1);
+}
+
+/*
+ * bin_min - smallest block size list i holds, 0 if no size goes to it
+ */
+static size_t bin_min(int i)
+{
+    size_t lo = 2*DSIZE / ALIGNMENT, hi = (size_t)-1 / ALIGNMENT, mid;
+
+    // In ALIGNMENT units, bin_index grows with the size
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (bin_index(mid * ALIGNMENT) < i)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return bin_index(lo * ALIGNMENT) == i ? lo * ALIGNMENT : 0;
+}
+
+/*
+ * sort_ptrs - Shell sort of block pointers by address.
+ *     Does not allocate, unlike qsort, which may call malloc.
+ */
+static void sort_ptrs(void **ptrs, int n)
+{
+    static const int gaps[] = { 701, 301, 132, 57, 23, 10, 4, 1 };
+    int g, i, j;
+    void *tmp;
+
+    for (g = 0; g < 8; g++) {
+        for (i = gaps[g]; i < n; i++) {
+            tmp = ptrs[i];
+            for (j = i; j >= gaps[g] && (char *)ptrs[j - gaps[g]] > (char *)tmp; j -= gaps[g])
+                ptrs[j] = ptrs[j - gaps[g]];
+            ptrs[j] = tmp;
+        }
+    }
+}
+
+/*
+ * zero_bytes - memset(p, 0, len), with non-temporal stores for long runs
+ *     so a large calloc does not push the rest of the heap out of the cache.
+ */
+static void zero_bytes(char *p, size_t len)
+{
+#ifdef __SSE2__
+    __m128i zero = _mm_setzero_si128();
+    size_t head;
+
+    if (len >= NT_ZERO_MIN) {
+        head = (16 - ((size_t)p & 15)) & 15;
+        memset(p, 0, head);
+        p += head;
+        len -= head;
+        for (; len >= 64; p += 64, len -= 64) {
+            _mm_stream_si128((__m128i *)p, zero);
+            _mm_stream_si128((__m128i *)(p + 16), zero);
+            _mm_stream_si128((__m128i *)(p + 32), zero);
+            _mm_stream_si128((__m128i *)(p + 48), zero);
+        }
+        _mm_sfence();
+    }
+#endif
+    memset(p, 0, len);
+}
+
+static void insert_node(void *ptr, size_t size) {
+    insert_bin(ptr, size, bin_index(size));
+}
+
+/*
+ * insert_bin - insert free block ptr of size bytes into segregated list i
+ */
+static void insert_bin(void *ptr, size_t size, int i) {
+    void *search_ptr = ptr;
+    void *insert_ptr = NULL;
     
-    // Keep size ascending order and search
-    search_ptr = segregated_free_lists[i];
-    while ((search_ptr != NULL) && (size > GET_SIZE(HDRP(search_ptr)))) {
+#ifdef MM_BIN_INDEX
+    // The index finds the place by binary search, its neighbors there are the list's
+    int at = ix_insert(i, ptr, size);
+
+    search_ptr = at > 0 ? IX_BLOCK(i, at - 1) : NULL;
+    insert_ptr = at + 1 < (int)IX_COUNT(i) ? IX_BLOCK(i, at + 1) : NULL;
+#else
+    // Keep size (or with MM_ORDER_ADDR address) ascending order and search
+    search_ptr = LIST_ROOT(i);
+    while ((search_ptr != NULL) && (ORDER(POLICY) == MM_ORDER_ADDR ? (char *)ptr > (char *)search_ptr :
+                                    size > GET_SIZE(HDRP(search_ptr)))) {
         insert_ptr = search_ptr;
         search_ptr = PRED_LIST(search_ptr);
     }
+#endif
     
     // Set predecessor and successor 
     if (search_ptr != NULL) {
@@ -389,7 +2444,7 @@ static void insert_node(void *ptr, size_t size) {
             PUT_PTR(PRED_ENT(ptr), search_ptr);
             PUT_PTR(SUCC_ENT(search_ptr), ptr);
             PUT_PTR(SUCC_ENT(ptr), NULL);
-            segregated_free_lists[i] = ptr;
+            SET_ROOT(i, ptr);
         }
     } else {
         if (insert_ptr != NULL) {
@@ -399,7 +2454,7 @@ static void insert_node(void *ptr, size_t size) {
         } else {
             PUT_PTR(PRED_ENT(ptr), NULL);
             PUT_PTR(SUCC_ENT(ptr), NULL);
-            segregated_free_lists[i] = ptr;
+            SET_ROOT(i, ptr);
         }
     }
     
@@ -408,14 +2463,13 @@ static void insert_node(void *ptr, size_t size) {
 
 
 static void delete_node(void *ptr) {
-    int i = 0;
-    size_t size = GET_SIZE(HDRP(ptr));
-    
-    // Select segregated list 
-    while ((i < 24 ) && (size > 1)) {
-        size >>= 1;
-        i++;
-    }
+    int i = bin_index(GET_SIZE(HDRP(ptr)));
+
+    if (FIT(POLICY) == MM_FIT_NEXT && GET_PTR(&meta->rover) == (char *)ptr)
+        PUT_PTR(&meta->rover, PRED_LIST(ptr));
+#ifdef MM_BIN_INDEX
+    ix_delete(i, ptr);
+#endif
     
     if (PRED_LIST(ptr) != NULL) {
         if (SUCC_LIST(ptr) != NULL) {
@@ -423,14 +2477,600 @@ static void delete_node(void *ptr) {
             PUT_PTR(PRED_ENT(SUCC_LIST(ptr)), PRED_LIST(ptr));
         } else {
             PUT_PTR(SUCC_ENT(PRED_LIST(ptr)), NULL);
-            segregated_free_lists[i] = PRED_LIST(ptr);
+            SET_ROOT(i, PRED_LIST(ptr));
         }
     } else {
         if (SUCC_LIST(ptr) != NULL) {
             PUT_PTR(PRED_ENT(SUCC_LIST(ptr)), NULL);
         } else {
-            segregated_free_lists[i] = NULL;
+            SET_ROOT(i, NULL);
+        }
+    }
+    return;
+}
+
+#ifndef MM_POLICY
+/*
+ * sort_lists - put every list back in the order of the placement policy
+ */
+static void sort_lists(void)
+{
+    char *ptr, *next;
+    int i;
+
+    for (i = 0; i < NBINS; i++) {
+        // From the tail, so a list already in order is rebuilt in one pass
+        for (ptr = LIST_ROOT(i); ptr != NULL && PRED_LIST(ptr) != NULL; ptr = PRED_LIST(ptr))
+            ;
+        SET_ROOT(i, NULL);
+#ifdef MM_BIN_INDEX
+        IX_COUNT(i) = 0;
+#endif
+        for (; ptr != NULL; ptr = next) {
+            next = SUCC_LIST(ptr);
+            insert_bin(ptr, GET_SIZE(HDRP(ptr)), i);
         }
     }
+}
+#endif
+
+#ifdef MM_BIN_INDEX
+/*
+ * ix_open - get the index of the current heap from memlib, empty if fresh.
+ *     The first call lays it out: a list can hold no more blocks than fit
+ *     in IX_SPAN with an allocated block after each, which for list i is
+ *     IX_SPAN over its smallest size plus 2*DSIZE.
+ */
+static int ix_open(int fresh)
+{
+  size_t at, lo;
+  int i;
+
+  if (ix_size == 0) {
+    at = (NBINS * sizeof(unsigned int) + 63) & ~(size_t)63;   /* the counts */
+    for (i = 0; i < NBINS; i++) {
+      lo = bin_min(i);
+      ix_at[i] = at;
+      ix_cap[i] = lo == 0 || lo > IX_SPAN ? 0 :
+                  (IX_SPAN / (lo + 2*DSIZE) + 15) & ~(size_t)15;
+      at += 2 * ix_cap[i] * sizeof(unsigned int);
+    }
+    ix_size = at;
+  }
+  if ((bin_ix = mem_index(ix_size, fresh)) == NULL)
+    return -1;
+  return 0;
+}
+
+/*
+ * ix_below - whether entry j of the index of list i lies on the tail side
+ *     of a block of size bytes at heap offset off. Entries descend by
+ *     address, or by size and then by address among blocks of one size.
+ */
+static int ix_below(int i, int j, unsigned int size, unsigned int off)
+{
+  unsigned int *sizes = IX_SIZES(i), *offs = IX_OFFS(i);
+
+  if (ORDER(POLICY) == MM_ORDER_ADDR)
+    return offs[j] > off;
+  return sizes[j] > size || (sizes[j] == size && offs[j] < off);
+}
+
+/*
+ * ix_find - entry of free block ptr in the index of list i, -1 if it has none
+ */
+static int ix_find(int i, char *ptr)
+{
+  unsigned int off = ptr - heap_base, size = GET_SIZE(HDRP(ptr));
+  int n = IX_COUNT(i), lo = 0, hi = n, mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (ix_below(i, mid, size, off))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo < n && IX_OFFS(i)[lo] == off ? lo : -1;
+}
+
+/*
+ * ix_fit - last entry in [lo, hi) of the index of list i with a size of at
+ *     least asize, the first such block in list order, -1 if none is.
+ */
+static int ix_fit(int i, int lo, int hi, size_t asize)
+{
+  unsigned int *sizes = IX_SIZES(i);
+#ifdef __SSE2__
+  __m128i bias = _mm_set1_epi32(INT_MIN);
+  __m128i want = _mm_set1_epi32((int)((unsigned int)(asize - 1) ^ 0x80000000u));
+  int mask;
+#endif
+
+  if (asize > UINT_MAX)
+    return -1;
+#ifdef __SSE2__
+  /* Unsigned compares, as signed ones with the top bit flipped */
+  for (; hi - lo >= 4; hi -= 4) {
+    __m128i v = _mm_xor_si128(_mm_loadu_si128((__m128i *)(sizes + hi - 4)), bias);
+
+    if ((mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, want)))) != 0)
+      return hi - 4 + 31 - __builtin_clz(mask);
+  }
+#endif
+  while (hi > lo)
+    if (sizes[--hi] >= asize)
+      return hi;
+  return -1;
+}
+
+/*
+ * ix_insert - enter free block ptr of size bytes into the index of list i
+ *     and return its entry. Among blocks of the same size it goes by address.
+ */
+static int ix_insert(int i, char *ptr, size_t size)
+{
+  unsigned int *sizes = IX_SIZES(i), *offs = IX_OFFS(i);
+  unsigned int off = ptr - heap_base;
+  int n = IX_COUNT(i)++, lo = 0, hi = n, mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (ix_below(i, mid, size, off))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  memmove(sizes + lo + 1, sizes + lo, (n - lo) * sizeof(unsigned int));
+  memmove(offs + lo + 1, offs + lo, (n - lo) * sizeof(unsigned int));
+  sizes[lo] = size;
+  offs[lo] = off;
+  return lo;
+}
+
+/*
+ * ix_delete - remove free block ptr from the index of list i
+ */
+static void ix_delete(int i, char *ptr)
+{
+  unsigned int *sizes = IX_SIZES(i), *offs = IX_OFFS(i);
+  int at = ix_find(i, ptr), n;
+
+  if (at < 0)                           /* mm_check reports it */
+    return;
+  n = --IX_COUNT(i);
+  memmove(sizes + at, sizes + at + 1, (n - at) * sizeof(unsigned int));
+  memmove(offs + at, offs + at + 1, (n - at) * sizeof(unsigned int));
+}
+#endif
+
+
+
+//------------------------------------------------------------------------------------------------
+/*
+ * Heap profiler
+ *
+ * Like tcmalloc, mm_malloc samples an allocation roughly every sample_rate bytes.
+ * The distance between samples is drawn from an exponential distribution so that
+ * every allocated byte has the same chance of being sampled. A sampled block has
+ * the 0x2 bit of its header set and its stack trace kept in the samples table
+ * until it is freed. mm_heap_profile writes the live samples in the legacy
+ * pprof heap format, pprof scales them back using the rate in the header line.
+ */
+
+/*
+ * fast_log2 - log2 of a positive double, good to about 0.01
+ */
+static double fast_log2(double d)
+{
+  union { double d; unsigned long long u; } x;
+  int e;
+
+  x.d = d;
+  e = (int)((x.u >> 52) & 0x7ff) - 1023;
+  x.u = (x.u & ~(0x7ffULL << 52)) | (1023ULL << 52);   /* mantissa in [1, 2) */
+  return e + (-0.34484843 * x.d + 2.02466578) * x.d - 1.67487759;
+}
+
+/*
+ * next_sample - bytes to allocate before taking the next sample
+ */
+static long next_sample(void)
+{
+  unsigned int x = sample_seed;
+  double q, interval;
+
+  if (sample_rate == 0)
+    return LONG_MAX;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  sample_seed = x;
+
+  /* -ln(U) * rate with U uniform in (0, 1], U = q / 2^26 */
+  q = (double)(x >> 6) + 1.0;
+  interval = (26 - fast_log2(q)) * 0.693147180559945 * sample_rate;
+  if (interval > LONG_MAX / 2)
+    return LONG_MAX / 2;
+  return (long)interval + 1;
+}
+
+static unsigned int sample_slot(void *ptr)
+{
+  return ((unsigned int)((unsigned long)ptr >> 3) * 2654435761u) & (SAMPLE_SLOTS - 1);
+}
+
+/*
+ * sample_alloc - record ptr as a sample and tag its header.
+ *     Called when sample_countdown runs out.
+ */
+static void sample_alloc(void *ptr, size_t size)
+{
+  unsigned int i;
+
+  sample_countdown = next_sample();
+  if (sample_rate == 0)
+    return;
+
+  /* Keep the table at most 3/4 full, drop the sample otherwise */
+  if (sample_count >= SAMPLE_SLOTS / 4 * 3)
     return;
+
+  for (i = sample_slot(ptr); samples[i].ptr != NULL; i = (i + 1) & (SAMPLE_SLOTS - 1))
+    ;
+  samples[i].ptr = ptr;
+  samples[i].size = size;
+  samples[i].depth = backtrace(samples[i].stack, SAMPLE_DEPTH);
+  sample_count++;
+
+  PUT(HDRP(ptr), GET(HDRP(ptr)) | 0x2);
+}
+
+/*
+ * sample_free - forget the sample of ptr, the block is being freed.
+ *     Linear probing, so later entries of the cluster are shifted back.
+ */
+static void sample_free(void *ptr)
+{
+  unsigned int i, j, home;
+
+  for (i = sample_slot(ptr); samples[i].ptr != ptr; i = (i + 1) & (SAMPLE_SLOTS - 1))
+    if (samples[i].ptr == NULL)
+      return;
+
+  j = i;
+  for (;;) {
+    samples[i].ptr = NULL;
+    do {
+      j = (j + 1) & (SAMPLE_SLOTS - 1);
+      if (samples[j].ptr == NULL) {
+        sample_count--;
+        return;
+      }
+      home = sample_slot(samples[j].ptr);
+    } while ((i <= j) ? (i < home && home <= j) : (i < home || home <= j));
+    samples[i] = samples[j];
+    i = j;
+  }
+}
+
+/*
+ * mm_set_sample_rate - sample about once every rate bytes, 0 turns sampling off
+ */
+void mm_set_sample_rate(size_t rate)
+{
+  sample_rate = rate;
+  sample_countdown = next_sample();
+}
+
+/*
+ * write_all - write(2) the whole buffer, return -1 on error
+ */
+static int write_all(int fd, const char *buf, size_t len)
+{
+  ssize_t n;
+
+  while (len > 0) {
+    if ((n = write(fd, buf, len)) <= 0)
+      return -1;
+    buf += n;
+    len -= n;
+  }
+  return 0;
+}
+
+/*
+ * mm_heap_profile - write the live sampled heap to fd in pprof format.
+ *     Nothing is allocated, so it is safe to call from any context.
+ */
+int mm_heap_profile(int fd)
+{
+  char buf[4096];
+  size_t bytes = 0;
+  int i, j, len, mfd;
+
+  for (i = 0; i < SAMPLE_SLOTS; i++)
+    if (samples[i].ptr != NULL)
+      bytes += samples[i].size;
+
+  len = snprintf(buf, sizeof(buf), "heap profile: %d: %lu [%d: %lu] @ heap_v2/%lu\n",
+                 sample_count, (unsigned long)bytes, sample_count, (unsigned long)bytes,
+                 (unsigned long)sample_rate);
+  if (write_all(fd, buf, len) < 0)
+    return -1;
+
+  for (i = 0; i < SAMPLE_SLOTS; i++) {
+    if (samples[i].ptr == NULL)
+      continue;
+    len = snprintf(buf, sizeof(buf), "1: %lu [1: %lu] @",
+                   (unsigned long)samples[i].size, (unsigned long)samples[i].size);
+    for (j = 0; j < samples[i].depth; j++)
+      len += snprintf(buf + len, sizeof(buf) - len, " %p", samples[i].stack[j]);
+    buf[len++] = '\n';
+    if (write_all(fd, buf, len) < 0)
+      return -1;
+  }
+
+  /* pprof needs the mappings to symbolize the addresses */
+  len = snprintf(buf, sizeof(buf), "\nMAPPED_LIBRARIES:\n");
+  if (write_all(fd, buf, len) < 0)
+    return -1;
+  if ((mfd = open("/proc/self/maps", O_RDONLY)) < 0)
+    return 0;
+  while ((len = read(mfd, buf, sizeof(buf))) > 0)
+    if (write_all(fd, buf, len) < 0)
+      break;
+  close(mfd);
+  return 0;
+}
+
+
+
+//------------------------------------------------------------------------------------------------
+/*
+ * Heap dump
+ *
+ * mm_heap_dump writes a binary snapshot of the heap layout for offline
+ * fragmentation analysis (see tools/heapmap.c). All fields are 4 byte words
+ * in host byte order, offsets are payload offsets from mem_heap_lo():
+ *
+ *   header   magic DUMP_MAGIC, DUMP_VERSION, heap size, block count, bin count
+ *   blocks   offset, size, flags   one per block from prologue to epilogue,
+ *                                  flags bit 0 alloc, bits 8-15 bin of free blocks
+ *   bins     bin, smallest size, length, offsets
+ *                                  one per segregated list, in list order,
+ *                                  the size 0 if the list is never used
+ */
+#define DUMP_MAGIC    0x44484d4d    /* "MMHD" */
+#define DUMP_VERSION  2
+#define DUMP_BUFWORDS 512
+
+typedef struct {
+  int fd;
+  int n;
+  unsigned int words[DUMP_BUFWORDS];
+} dump_buf_t;
+
+static int dump_flush(dump_buf_t *b)
+{
+  int err = write_all(b->fd, (char *)b->words, b->n * sizeof(unsigned int));
+
+  b->n = 0;
+  return err;
+}
+
+static int dump_word(dump_buf_t *b, unsigned int w)
+{
+  b->words[b->n++] = w;
+  if (b->n == DUMP_BUFWORDS)
+    return dump_flush(b);
+  return 0;
+}
+
+/*
+ * mm_heap_dump - write the heap layout and bin membership to fd.
+ *     Walks the blocks with NEXT from the prologue to the epilogue, then each
+ *     segregated list with PRED_LIST. Nothing is allocated. Segments are
+ *     left out of the layout, their free blocks still show in the lists.
+ */
+int mm_heap_dump(int fd)
+{
+  dump_buf_t b;
+  char *lo = mem_heap_lo();
+  char *ptr;
+  unsigned int nblocks = 0, len, flags;
+  int i, err = 0;
+
+  b.fd = fd;
+  b.n = 0;
+
+  for (ptr = NEXT(heap_listp); GET_SIZE(HDRP(ptr)) > 0; ptr = NEXT(ptr))
+    nblocks++;
+
+  err |= dump_word(&b, DUMP_MAGIC);
+  err |= dump_word(&b, DUMP_VERSION);
+  err |= dump_word(&b, (unsigned int)mem_heapsize());
+  err |= dump_word(&b, nblocks);
+  err |= dump_word(&b, NBINS);
+
+  for (ptr = NEXT(heap_listp); GET_SIZE(HDRP(ptr)) > 0; ptr = NEXT(ptr)) {
+    flags = GET_ALLOC(HDRP(ptr)) ? 1 : (bin_index(GET_SIZE(HDRP(ptr))) << 8);
+    err |= dump_word(&b, (unsigned int)(ptr - lo));
+    err |= dump_word(&b, GET_SIZE(HDRP(ptr)));
+    err |= dump_word(&b, flags);
+  }
+
+  for (i = 0; i < NBINS; i++) {
+    len = 0;
+    for (ptr = LIST_ROOT(i); ptr != NULL; ptr = PRED_LIST(ptr))
+      len++;
+    err |= dump_word(&b, i);
+    err |= dump_word(&b, (unsigned int)MIN(bin_min(i), UINT_MAX));
+    err |= dump_word(&b, len);
+    for (ptr = LIST_ROOT(i); ptr != NULL; ptr = PRED_LIST(ptr))
+      err |= dump_word(&b, (unsigned int)(ptr - lo));
+  }
+
+  err |= dump_flush(&b);
+  return err ? -1 : 0;
+}
+
+
+
+//------------------------------------------------------------------------------------------------
+/*
+ * Pre-warming
+ *
+ * mm_size_profile records how many blocks of each size are allocated, as
+ * text lines "size count" with block sizes as in the headers. A later run
+ * hands the file to mm_prewarm right after mm_init, which grows the heap
+ * once and splits it into free blocks of those sizes, so the first
+ * requests find a block of their size in their list instead of extending
+ * the heap and splitting a block each. A minimum size allocated block
+ * after each one keeps it from merging with the next, as no two free
+ * blocks may lie side by side. Such a fence only stays until a block next
+ * to it is freed, then drop_fences merges it and the blocks on both sides,
+ * so the heap does not keep the profile's sizes for good.
+ */
+#define PROF_SLOTS    4096          /* distinct sizes recorded, a power of two */
+#define PROF_MAXSIZE  (1 << 16)     /* larger blocks are not worth pre-splitting */
+#define PREWARM_MAX   (1 << 28)     /* bytes mm_prewarm grows the heap by at most */
+
+typedef struct {
+  unsigned int size;
+  unsigned int count;
+} prof_entry_t;
+
+static prof_entry_t prof[PROF_SLOTS];
+
+/*
+ * mm_size_profile - write the sizes of the allocated blocks to fd.
+ *     Nothing is allocated. Returns 0 on success, -1 on a write error.
+ */
+int mm_size_profile(int fd)
+{
+  char buf[64], *ptr;
+  unsigned int size, i, probes;
+  int len, r;
+
+  memset(prof, 0, sizeof(prof));
+  for (r = 0; (ptr = first_block(r)) != NULL; r++) {
+    for (; GET_SIZE(HDRP(ptr)) > 0; ptr = NEXT(ptr)) {
+      if (!GET_ALLOC(HDRP(ptr)) || IS_FENCE(ptr) || (size = GET_SIZE(HDRP(ptr))) > PROF_MAXSIZE)
+        continue;
+      /* Linear probing, sizes past a full table are left out */
+      i = (size / ALIGNMENT) & (PROF_SLOTS - 1);
+      for (probes = 0; probes < PROF_SLOTS && prof[i].size != 0 && prof[i].size != size; probes++)
+        i = (i + 1) & (PROF_SLOTS - 1);
+      if (probes == PROF_SLOTS)
+        continue;
+      prof[i].size = size;
+      prof[i].count++;
+    }
+  }
+
+  len = snprintf(buf, sizeof(buf), "# mm size profile\n");
+  if (write_all(fd, buf, len) < 0)
+    return -1;
+  for (i = 0; i < PROF_SLOTS; i++) {
+    if (prof[i].count == 0)
+      continue;
+    len = snprintf(buf, sizeof(buf), "%u %u\n", prof[i].size, prof[i].count);
+    if (write_all(fd, buf, len) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+/*
+ * mm_prewarm - split the heap into free blocks as recorded in the size
+ *     profile read from fd, each followed by a fence that stays until a
+ *     block next to it is freed. Sizes that do not fit
+ *     this build are skipped and the heap grows by at most PREWARM_MAX
+ *     bytes. Returns the number of blocks made, or -1 if the heap could
+ *     not grow.
+ */
+int mm_prewarm(int fd)
+{
+  static char text[PROF_SLOTS * 24];
+  prof_entry_t e;
+  unsigned long size, count;
+  size_t total = 0, csize, len = 0;
+  unsigned int clean;
+  char *line, *end, *ptr, *base;
+  int i, j, n = 0, made = 0;
+  ssize_t r;
+
+  while (len < sizeof(text) - 1 && (r = read(fd, text + len, sizeof(text) - 1 - len)) > 0)
+    len += r;
+  text[len] = '\0';
+
+  /* Keep the usable entries in prof */
+  for (line = text; *line != '\0'; line = end) {
+    if ((end = strchr(line, '\n')) != NULL)
+      *end++ = '\0';
+    else
+      end = line + strlen(line);
+    if (sscanf(line, "%lu %lu", &size, &count) != 2 || size < 2 * DSIZE ||
+        size > PROF_MAXSIZE || size % ALIGNMENT != 0 || count == 0 || n == PROF_SLOTS)
+      continue;
+    count = MIN(count, (PREWARM_MAX - total) / (size + 2 * DSIZE));
+    if (count == 0)
+      continue;
+    prof[n].size = size;
+    prof[n].count = count;
+    total += (size + 2 * DSIZE) * count;
+    n++;
+  }
+  if (total == 0)
+    return 0;
+
+  /* Largest first, see the inserts below */
+  for (i = 1; i < n; i++) {
+    e = prof[i];
+    for (j = i; j > 0 && prof[j-1].size < e.size; j--)
+      prof[j] = prof[j-1];
+    prof[j] = e;
+  }
+
+  if ((ptr = extend_heap(total)) == NULL)
+    return -1;
+  csize = GET_SIZE(HDRP(ptr));
+  clean = GET_CLEAN(HDRP(ptr));
+  delete_node(ptr);
+  base = ptr;
+
+  for (i = 0; i < n; i++) {
+    for (count = 0; count < prof[i].count && csize >= prof[i].size + 4 * DSIZE; count++) {
+      PUT(HDRP(ptr), PACK(prof[i].size, 0) | clean);
+      PUT(FTRP(ptr), PACK(prof[i].size, 0));
+      ptr = NEXT(ptr);
+      PUT(HDRP(ptr), PACK(2 * DSIZE, 1));
+      PUT(FTRP(ptr), PACK(2 * DSIZE, 1) | FENCE_TAG | clean);
+      MARK_LIVE(ptr);
+      csize -= prof[i].size + 2 * DSIZE;
+      ptr = NEXT(ptr);
+      made++;
+    }
+  }
+  PUT(HDRP(ptr), PACK(csize, 0) | clean);
+  PUT(FTRP(ptr), PACK(csize, 0));
+
+  /*
+   * Each insert lands at the head of its list and the end of its index:
+   * by address from the top down, by size from the largest, which lies
+   * lowest, up. The rest of the new heap goes in last.
+   */
+  if (ORDER(POLICY) == MM_ORDER_ADDR) {
+    for (; ptr != base; ptr = PREV(PREV(ptr)))
+      insert_node(ptr, GET_SIZE(HDRP(ptr)));
+    insert_node(base, GET_SIZE(HDRP(base)));
+  }
+  else {
+    for (end = ptr, ptr = base; ptr != end; ptr = NEXT(NEXT(ptr)))
+      insert_node(ptr, GET_SIZE(HDRP(ptr)));
+    insert_node(end, csize);
+  }
+  return made;
 }
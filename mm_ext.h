@@ -0,0 +1,81 @@
+/*
+ * mm_ext.h - mm.c interfaces beyond the ones of the lab's mm.h
+ */
+#ifndef MM_EXT_H
+#define MM_EXT_H
+
+#include <stddef.h>
+
+/* mm_mallocx flags */
+#define MM_LG_ALIGN(la)  ((int)(la))    /* payload aligned to 2^la bytes */
+#define MM_ZERO          0x40           /* zero the payload */
+#define MM_CACHELINE     0x80           /* payload owns whole cache lines */
+#define MM_EXACT         0x100          /* a block that fits closely is not split */
+
+/*
+ * Placement policy for mm_set_policy, one fit, one order and one split
+ * or'ed together. In lists sorted by size the first fit is the best one.
+ * Building mm.c with -DMM_POLICY=<policy> fixes it at compile time.
+ */
+#define MM_FIT_FIRST     0x0            /* first block in list order that fits */
+#define MM_FIT_BEST      0x1            /* smallest block that fits */
+#define MM_FIT_NEXT      0x2            /* first fit from where the last search stopped */
+#define MM_FIT_GOOD(n)   (0x3 | (n) << 16) /* best of the first n+1 blocks that fit */
+#define MM_ORDER_SIZE    0x00           /* free lists sorted by size */
+#define MM_ORDER_ADDR    0x10           /* free lists sorted by address */
+#define MM_SPLIT_SIZE    0x000          /* large blocks at the end of a free block, small at the start */
+#define MM_SPLIT_LOW     0x100          /* blocks at the start of a free block */
+#define MM_SPLIT_HIGH    0x200          /* blocks at the end of a free block */
+
+/* Relocatable blocks, reached through a handle and moved by mm_compact */
+typedef struct mm_handle *mm_handle_t;
+
+void *mm_calloc(size_t nmemb, size_t size);
+void *mm_memalign(size_t align, size_t size);
+size_t mm_usable_size(void *ptr);
+size_t mm_try_expand(void *ptr, size_t min, size_t max);
+void *mm_mallocx(size_t size, int flags);
+void mm_sdallocx(void *ptr, size_t size, int flags);
+
+int mm_malloc_batch(size_t size, int n, void **out);
+void mm_free_batch(void **ptrs, int n);
+
+mm_handle_t mm_halloc(size_t size);
+void *mm_hlock(mm_handle_t h);
+void mm_hunlock(mm_handle_t h);
+void mm_hfree(mm_handle_t h);
+size_t mm_compact(size_t budget);
+size_t mm_trim(size_t pad);
+size_t mm_purge(size_t budget);
+int mm_check(size_t budget);
+void mm_set_check_rate(long every, size_t budget);
+
+/* Memory budget: called with the bytes a growing heap would pass the soft limit by */
+typedef void (*mm_pressure_fn)(size_t over, void *arg);
+
+void mm_set_limits(size_t soft, size_t hard);
+void mm_set_pressure_handler(mm_pressure_fn fn, void *arg);
+size_t mm_footprint(void);
+int mm_in_pressure_handler(void);
+
+int mm_set_policy(int policy);
+void mm_use_heap(void);
+void mm_set_root(void *ptr);
+void *mm_get_root(void);
+
+/* mm_shared.c, a heap shared between processes */
+int mm_shared_init(void);
+void *mm_shared_malloc(size_t size);
+void mm_shared_free(void *ptr);
+void *mm_shared_calloc(size_t nmemb, size_t size);
+void *mm_shared_realloc(void *ptr, size_t size);
+void mm_shared_set_root(void *ptr);
+void *mm_shared_get_root(void);
+
+void mm_set_sample_rate(size_t rate);
+int mm_heap_profile(int fd);
+int mm_heap_dump(int fd);
+int mm_size_profile(int fd);
+int mm_prewarm(int fd);
+
+#endif
@@ -0,0 +1,576 @@
+/*
+ * mm_preload.c - mm.c as the malloc of a whole process.
+ *
+ * Provides the C library allocation functions on top of mm_malloc/mm_free,
+ * with memlib_os.c as the heap instead of the lab's simulated one:
+ *
+ *   gcc -O2 -fPIC -shared -DMM_SBRK_ZEROES -DMM_SBRK_SHRINKS -o libmm.so mm.c memlib_os.c mm_preload.c -lpthread
+ *   LD_PRELOAD=./libmm.so program
+ *
+ * mm.c is not thread safe, so every call holds one global lock. Calls that
+ * come back into the allocator from inside it on the same thread (backtrace()
+ * loads libgcc through dlopen, which allocates) are served from a static
+ * bootstrap arena instead of deadlocking on that lock.
+ *
+ * memlib_os.c hands out zeroed memory and can lower the break, so mm.c is
+ * built with MM_SBRK_ZEROES, letting calloc skip zeroing memory that was
+ * never used, and MM_SBRK_SHRINKS, letting malloc_trim release the top.
+ *
+ * With MM_MAINTAIN_MS set, a maintenance thread wakes up that often and, when
+ * no request holds the lock, does the work that need not happen in a request:
+ * it frees the blocks whose free found the lock taken and left them in a
+ * table, trims the top of the heap and purges the pages of large free blocks
+ * (mm_purge). A free then only waits for the lock when the table is full.
+ * The table is kept apart from the blocks, so a block freed twice reaches
+ * mm_free untouched and is caught there. The lock stays a single
+ * one, as the blocks of one list coalesce with blocks of any other, so the
+ * thread only takes it with trylock and a bounded amount of work. A child
+ * after fork has no such thread, its deferred frees are done by requests.
+ *
+ * Built with -DMM_NUMA there is a heap per NUMA node (see memlib_os.c).
+ * Allocations come from the heap of the node the calling thread runs on,
+ * and frees go back to the heap that owns the block.
+ *
+ * Environment:
+ *   MM_SAMPLE_RATE   mean bytes between heap profile samples, default off
+ *   MM_HEAP_PROFILE  file the sampled heap profile is written to at exit
+ *   MM_SIZE_PROFILE  file the sizes of the live blocks are written to at exit
+ *   MM_PREWARM       size profile of an earlier run to pre-split the heap by
+ *   MM_PLACEMENT     placement policy word of mm_ext.h, as in 0x112, for
+ *                    comparing policies without rebuilding
+ *   MM_MAINTAIN_MS   milliseconds between runs of the maintenance thread,
+ *                    default no thread
+ *   MM_HEAP_CHECK    every,blocks: every that many malloc and free calls
+ *                    check the next blocks of the heap (mm_check) and abort
+ *                    on corruption, blocks defaulting to 16
+ *   MM_HEAP_LIMIT    soft,hard: limits of the heap's footprint in bytes,
+ *                    K, M or G suffixes allowed, 0 for none. Past soft the
+ *                    heap is purged and trimmed before it grows, past hard
+ *                    allocations fail (mm_set_limits)
+ *   MM_NUMA_NODES    with MM_NUMA, pretend there are this many nodes and
+ *                    that CPU n is on node n modulo that, for testing
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <execinfo.h>
+#ifdef MM_NUMA
+#include <sys/syscall.h>
+#endif
+
+#include "mm.h"
+#include "mm_ext.h"
+#include "memlib.h"
+
+#ifdef MM_LARGE
+#define MAX_REQUEST  ((size_t)PTRDIFF_MAX)
+#else
+#define MAX_REQUEST  ((size_t)1 << 31)   /* mem_sbrk takes an int */
+#endif
+#define BOOT_SIZE    (1 << 16)
+#define BOOT_ALIGN   16
+
+#define MAINT_TRIM_PAD (1 << 20)        /* top of the heap the maintenance thread keeps */
+#define MAINT_PURGE    (1 << 23)        /* mm_purge budget per run */
+#define DEFER_MAX      4096             /* deferred frees a request lets pile up */
+#define DEFER_SLOTS    8192             /* deferred frees there is room for */
+#define DEFER_BATCH    256              /* blocks per mm_free_batch */
+
+/* Bootstrap arena for recursive calls, each chunk has its size in front */
+static char boot_arena[BOOT_SIZE] __attribute__((aligned(BOOT_ALIGN)));
+static size_t boot_used;
+
+static pthread_mutex_t mm_lock = PTHREAD_MUTEX_INITIALIZER;
+static int mm_ready;
+static int placement;                   /* MM_PLACEMENT, for heaps made later */
+static __thread int in_mm __attribute__((tls_model("initial-exec")));
+
+/* Frees left to the maintenance thread, in slots that are NULL when empty */
+static int maint_ms;                    /* 0 = no maintenance thread */
+static void *deferred[DEFER_SLOTS];
+static unsigned int defer_next;         /* slot the next defer_free tries first */
+static int ndeferred;
+
+static void *boot_alloc(size_t align, size_t size)
+{
+  size_t start;
+
+  if (align < BOOT_ALIGN)
+    align = BOOT_ALIGN;
+  start = (boot_used + BOOT_ALIGN + align - 1) & ~(align - 1);
+  if (size > BOOT_SIZE || start + size > BOOT_SIZE) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  *(size_t *)(boot_arena + start - BOOT_ALIGN) = size;
+  boot_used = start + size;
+  return boot_arena + start;
+}
+
+static int is_boot(void *ptr)
+{
+  return (char *)ptr >= boot_arena && (char *)ptr < boot_arena + BOOT_SIZE;
+}
+
+static size_t boot_size(void *ptr)
+{
+  return *(size_t *)((char *)ptr - BOOT_ALIGN);
+}
+
+#ifdef MM_NUMA
+int mem_select(int node);
+int mem_node_of(void *ptr);
+
+static int numa_nodes;          /* MM_NUMA_NODES, 0 for the real topology */
+
+/*
+ * use_node - switch mm.c to the heap of node, building it on first use.
+ *     Stays on the current heap if node has none and cannot get one.
+ */
+static void use_node(int node)
+{
+  switch (mem_select(node)) {
+    case 0:
+      mm_use_heap();
+      break;
+    case 1:
+      if (mm_init(NULL) < 0) {
+        fprintf(stderr, "mm_preload: cannot create the heap of node %d\n", node);
+        abort();
+      }
+      mm_set_policy(placement);
+      break;
+  }
+}
+
+static int current_node(void)
+{
+  unsigned int cpu, node;
+
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+    return 0;
+  return numa_nodes > 0 ? (int)(cpu % numa_nodes) : (int)node;
+}
+
+#define USE_LOCAL_HEAP()    use_node(current_node())
+#define USE_OWNER_HEAP(ptr) use_node(mem_node_of(ptr))
+#else
+#define USE_LOCAL_HEAP()
+#define USE_OWNER_HEAP(ptr)
+#endif
+
+static void prepare_fork(void) { pthread_mutex_lock(&mm_lock); }
+static void release_fork(void) { pthread_mutex_unlock(&mm_lock); }
+
+/*
+ * defer_free - leave the free of ptr to whoever takes mm_lock next, without
+ *     taking it. Returns 0 if every slot is taken.
+ */
+static int defer_free(void *ptr)
+{
+  unsigned int i = __atomic_fetch_add(&defer_next, 1, __ATOMIC_RELAXED), n;
+  void *empty;
+
+  for (n = 0; n < DEFER_SLOTS; n++, i++) {
+    empty = NULL;
+    if (__atomic_compare_exchange_n(&deferred[i % DEFER_SLOTS], &empty, ptr, 0,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+      __atomic_add_fetch(&ndeferred, 1, __ATOMIC_RELAXED);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * free_deferred - free the blocks defer_free left, called with mm_lock held.
+ *     They go through mm_free_batch, which merges neighbors among them.
+ */
+static void free_deferred(void)
+{
+  void *batch[DEFER_BATCH];
+  char *ptr;
+  int i, n = 0, freed = 0;
+
+  if (__atomic_load_n(&ndeferred, __ATOMIC_RELAXED) == 0)
+    return;
+  for (i = 0; i < DEFER_SLOTS; i++) {
+    if (__atomic_load_n(&deferred[i], __ATOMIC_RELAXED) == NULL)
+      continue;
+    ptr = __atomic_exchange_n(&deferred[i], NULL, __ATOMIC_ACQUIRE);
+    freed++;
+#ifdef MM_NUMA
+    USE_OWNER_HEAP(ptr);
+    mm_free(ptr);
+#else
+    batch[n++] = ptr;
+    if (n == DEFER_BATCH) {
+      mm_free_batch(batch, n);
+      n = 0;
+    }
+#endif
+  }
+  mm_free_batch(batch, n);
+  __atomic_sub_fetch(&ndeferred, freed, __ATOMIC_RELAXED);
+}
+
+#ifdef MM_NUMA
+/*
+ * free_in_handler - free ptr from the pressure handler, which runs on the
+ *     heap of this node with mm_lock held. The block is deferred, or if no
+ *     slot is left freed now along with the deferred ones, each on its own
+ *     heap, before going back to this one.
+ */
+static void free_in_handler(void *ptr)
+{
+  int node;
+
+  if (defer_free(ptr))
+    return;
+  node = mem_node_of(mem_heap_lo());
+  free_deferred();
+  USE_OWNER_HEAP(ptr);
+  mm_free(ptr);
+  use_node(node);
+}
+#endif
+
+/*
+ * maintain - body of the maintenance thread
+ */
+static void *maintain(void *arg)
+{
+  struct timespec ts;
+
+  (void)arg;
+  ts.tv_sec = maint_ms / 1000;
+  ts.tv_nsec = (maint_ms % 1000) * 1000000L;
+  for (;;) {
+    nanosleep(&ts, NULL);
+    /* A request holds the allocator, this is no idle time */
+    if (pthread_mutex_trylock(&mm_lock) != 0)
+      continue;
+    in_mm = 1;
+    free_deferred();
+    USE_LOCAL_HEAP();
+    mm_trim(MAINT_TRIM_PAD);
+    mm_purge(MAINT_PURGE);
+    pthread_mutex_unlock(&mm_lock);
+    in_mm = 0;
+  }
+  return NULL;
+}
+
+/*
+ * parse_size - bytes in s, with an optional K, M or G suffix
+ */
+static size_t parse_size(const char *s, char **end)
+{
+  size_t n = strtoull(s, end, 10);
+
+  switch (**end) {
+    case 'G': case 'g': n <<= 10; /* fall through */
+    case 'M': case 'm': n <<= 10; /* fall through */
+    case 'K': case 'k': n <<= 10; (*end)++;
+  }
+  return n;
+}
+
+/*
+ * mm_setup - set up the heap on first use, called with mm_lock held
+ */
+static void mm_setup(void)
+{
+  char *rate, *path;
+  void *frame;
+  pthread_t thread;
+  pthread_attr_t attr;
+  int fd;
+
+#ifdef MM_NUMA
+  if ((rate = getenv("MM_NUMA_NODES")) != NULL)
+    numa_nodes = atoi(rate);
+#endif
+  mem_init();
+  if (mm_init(NULL) < 0) {
+    fprintf(stderr, "mm_preload: cannot create the heap\n");
+    abort();
+  }
+  pthread_atfork(prepare_fork, release_fork, release_fork);
+
+  if ((rate = getenv("MM_PLACEMENT")) != NULL) {
+    placement = strtol(rate, NULL, 0);
+    if (mm_set_policy(placement) < 0)
+      fprintf(stderr, "mm_preload: MM_PLACEMENT ignored, the policy is fixed at build time\n");
+  }
+
+  if ((path = getenv("MM_PREWARM")) != NULL && (fd = open(path, O_RDONLY)) >= 0) {
+    mm_prewarm(fd);
+    close(fd);
+  }
+
+  if ((rate = getenv("MM_SAMPLE_RATE")) != NULL && atol(rate) > 0) {
+    /* Let backtrace do its one-time allocations now, from the arena */
+    backtrace(&frame, 1);
+    mm_set_sample_rate(atol(rate));
+  }
+
+  if ((rate = getenv("MM_HEAP_CHECK")) != NULL && atol(rate) > 0) {
+    char *blocks = strchr(rate, ',');
+
+    mm_set_check_rate(atol(rate), blocks != NULL && atol(blocks + 1) > 0 ? atol(blocks + 1) : 16);
+  }
+
+  if ((rate = getenv("MM_HEAP_LIMIT")) != NULL) {
+    size_t soft = parse_size(rate, &path), hard = 0;
+
+    if (*path == ',')
+      hard = parse_size(path + 1, &path);
+    mm_set_limits(soft, hard);
+  }
+
+  if ((rate = getenv("MM_MAINTAIN_MS")) != NULL && atoi(rate) > 0) {
+    maint_ms = atoi(rate);
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attr, maintain, NULL) != 0)
+      maint_ms = 0;
+    pthread_attr_destroy(&attr);
+  }
+  mm_ready = 1;
+}
+
+/*
+ * enter - take the allocator, return 0 if this is a recursive call
+ */
+static int enter(void)
+{
+  if (in_mm)
+    return 0;
+  in_mm = 1;
+  pthread_mutex_lock(&mm_lock);
+  if (!mm_ready)
+    mm_setup();
+  if (ndeferred > DEFER_MAX)
+    free_deferred();
+  return 1;
+}
+
+static void leave(void)
+{
+  pthread_mutex_unlock(&mm_lock);
+  in_mm = 0;
+}
+
+static void *alloc_aligned(size_t align, size_t size)
+{
+  void *ptr;
+
+  if (size == 0)
+    size = 1;
+  if (size > MAX_REQUEST) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  if (!enter())
+    return boot_alloc(align, size);
+  USE_LOCAL_HEAP();
+  ptr = (align <= 8) ? mm_malloc(size) : mm_memalign(align, size);
+  leave();
+  if (ptr == NULL)
+    errno = ENOMEM;
+  return ptr;
+}
+
+void *malloc(size_t size)
+{
+  return alloc_aligned(0, size);
+}
+
+void free(void *ptr)
+{
+  if (ptr == NULL || is_boot(ptr))
+    return;
+  /* A recursive free would interrupt mm_malloc, leak the block instead.
+     The pressure handler runs where the heap is whole, its frees can go
+     to it, or with MM_NUMA to the heap they belong to. */
+  if (in_mm) {
+    if (mm_in_pressure_handler()) {
+#ifdef MM_NUMA
+      free_in_handler(ptr);
+#else
+      mm_free(ptr);
+#endif
+    }
+    return;
+  }
+  if (maint_ms && pthread_mutex_trylock(&mm_lock) != 0) {
+    if (defer_free(ptr))
+      return;
+    pthread_mutex_lock(&mm_lock);       /* no slot left */
+  }
+  if (maint_ms)
+    in_mm = 1;
+  else if (!enter())
+    return;
+  USE_OWNER_HEAP(ptr);
+  mm_free(ptr);
+  leave();
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+  void *ptr;
+
+  if (size != 0 && nmemb > (size_t)-1 / size) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  if (nmemb == 0 || size == 0)
+    nmemb = size = 1;
+  if (nmemb * size > MAX_REQUEST) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  /* The bootstrap arena is never reused, so it is still zero */
+  if (!enter())
+    return boot_alloc(0, nmemb * size);
+  USE_LOCAL_HEAP();
+  ptr = mm_calloc(nmemb, size);
+  leave();
+  if (ptr == NULL)
+    errno = ENOMEM;
+  return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+  void *newptr;
+  size_t oldsize;
+
+  if (ptr == NULL)
+    return malloc(size);
+  if (size == 0) {
+    free(ptr);
+    return NULL;
+  }
+  if (size > MAX_REQUEST) {
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  if (!is_boot(ptr) && enter()) {
+    USE_OWNER_HEAP(ptr);
+    newptr = mm_realloc(ptr, size);
+    leave();
+    if (newptr == NULL)
+      errno = ENOMEM;
+    return newptr;
+  }
+
+  /* Chunks of the bootstrap arena are copied out, recursive calls stay in it */
+  oldsize = is_boot(ptr) ? boot_size(ptr) : 0;
+  if ((newptr = malloc(size)) != NULL)
+    memcpy(newptr, ptr, oldsize < size ? oldsize : size);
+  return newptr;
+}
+
+void *reallocarray(void *ptr, size_t nmemb, size_t size)
+{
+  if (size != 0 && nmemb > (size_t)-1 / size) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  return realloc(ptr, nmemb * size);
+}
+
+int posix_memalign(void **memptr, size_t align, size_t size)
+{
+  void *ptr;
+
+  if (align < sizeof(void *) || (align & (align - 1)) != 0)
+    return EINVAL;
+  if ((ptr = alloc_aligned(align, size)) == NULL)
+    return ENOMEM;
+  *memptr = ptr;
+  return 0;
+}
+
+void *aligned_alloc(size_t align, size_t size)
+{
+  if (align == 0 || (align & (align - 1)) != 0) {
+    errno = EINVAL;
+    return NULL;
+  }
+  return alloc_aligned(align, size);
+}
+
+void *memalign(size_t align, size_t size)
+{
+  return aligned_alloc(align, size);
+}
+
+void *valloc(size_t size)
+{
+  return alloc_aligned(getpagesize(), size);
+}
+
+void *pvalloc(size_t size)
+{
+  size_t pagesize = getpagesize();
+
+  return alloc_aligned(pagesize, (size + pagesize - 1) & ~(pagesize - 1));
+}
+
+size_t malloc_usable_size(void *ptr)
+{
+  if (ptr == NULL)
+    return 0;
+  if (is_boot(ptr))
+    return boot_size(ptr);
+  return mm_usable_size(ptr);
+}
+
+int malloc_trim(size_t pad)
+{
+  size_t released;
+
+  if (!enter())
+    return 0;
+  USE_LOCAL_HEAP();
+  released = mm_trim(pad);
+  leave();
+  return released != 0;
+}
+
+/*
+ * write_profile - dump the sampled heap to $MM_HEAP_PROFILE and the block
+ *     sizes to $MM_SIZE_PROFILE at exit
+ */
+__attribute__((destructor))
+static void write_profile(void)
+{
+  char *path;
+  int fd;
+
+  if (!mm_ready)
+    return;
+  pthread_mutex_lock(&mm_lock);
+  if ((path = getenv("MM_HEAP_PROFILE")) != NULL &&
+      (fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) >= 0) {
+    mm_heap_profile(fd);
+    close(fd);
+  }
+  if ((path = getenv("MM_SIZE_PROFILE")) != NULL &&
+      (fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) >= 0) {
+    mm_size_profile(fd);
+    close(fd);
+  }
+  pthread_mutex_unlock(&mm_lock);
+}
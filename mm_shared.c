@@ -0,0 +1,95 @@
+/*
+ * mm_shared.c - mm.c as one heap shared by several processes.
+ *
+ * Built with -DMM_SHARED, memlib_os.c maps the POSIX shared memory object
+ * named by MM_SHM_NAME (or the file MM_HEAP_FILE) at the same address in
+ * every process that attaches to it, so pointers stored in the heap mean
+ * the same thing everywhere. All of mm.c's state is inside the heap, and
+ * every call below holds the process-shared lock kept next to it:
+ *
+ *   gcc -O2 -DMM_SHARED -DMM_SBRK_ZEROES -DMM_SBRK_SHRINKS -o worker worker.c mm.c memlib_os.c mm_shared.c -lpthread -lrt
+ *   MM_SHM_NAME=/lookup ./worker
+ *
+ * The first process to attach creates the heap, the others check it and
+ * carry on with it. The object stays until it is removed with shm_unlink.
+ */
+#include <stddef.h>
+
+#include "mm.h"
+#include "mm_ext.h"
+#include "memlib.h"
+
+void mem_lock(void);
+void mem_unlock(void);
+
+/*
+ * mm_shared_init - attach this process to the shared heap, creating it
+ *     if it does not exist yet. Returns 0 on success, -1 if the heap found
+ *     there is damaged.
+ */
+int mm_shared_init(void)
+{
+  int err;
+
+  mem_init();
+  mem_lock();
+  err = mm_init(NULL);
+  mem_unlock();
+  return err;
+}
+
+void *mm_shared_malloc(size_t size)
+{
+  void *ptr;
+
+  mem_lock();
+  ptr = mm_malloc(size);
+  mem_unlock();
+  return ptr;
+}
+
+void mm_shared_free(void *ptr)
+{
+  mem_lock();
+  mm_free(ptr);
+  mem_unlock();
+}
+
+void *mm_shared_calloc(size_t nmemb, size_t size)
+{
+  void *ptr;
+
+  mem_lock();
+  ptr = mm_calloc(nmemb, size);
+  mem_unlock();
+  return ptr;
+}
+
+void *mm_shared_realloc(void *ptr, size_t size)
+{
+  mem_lock();
+  ptr = mm_realloc(ptr, size);
+  mem_unlock();
+  return ptr;
+}
+
+/*
+ * mm_shared_set_root/mm_shared_get_root - the pointer other processes
+ *     start from to find the shared data.
+ */
+void mm_shared_set_root(void *ptr)
+{
+  mem_lock();
+  mm_set_root(ptr);
+  mem_unlock();
+}
+
+void *mm_shared_get_root(void)
+{
+  void *ptr;
+
+  mem_lock();
+  ptr = mm_get_root();
+  mem_unlock();
+  return ptr;
+}
@@ -0,0 +1,57 @@
+/*
+ * index_ties.c
+ *
+ * Frees 200000 blocks of one size, each between two allocated ones, and
+ * allocates them back. With MM_BIN_INDEX every one of them sits in the same
+ * list with the same size, so finding a block in the index has to go by
+ * its address too. Fails if the heap check does or if it takes more than
+ * a second, which a search through all blocks of the size would.
+ *
+ * Usage: index_ties
+ *   gcc -Wall -O2 -DMM_BIN_INDEX -I. -o index_ties tests/index_ties.c mm.c memlib_os.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "mm.h"
+#include "mm_ext.h"
+#include "memlib.h"
+
+#define NBLOCKS 200000
+
+static void *blocks[2 * NBLOCKS];
+
+int main(void)
+{
+  struct timespec t0, t1;
+  double secs;
+  int i;
+
+  mem_init();
+  if (mm_init(NULL) < 0) {
+    fprintf(stderr, "index_ties: mm_init failed\n");
+    return 1;
+  }
+  for (i = 0; i < 2 * NBLOCKS; i++)
+    if ((blocks[i] = mm_malloc(40)) == NULL) {
+      fprintf(stderr, "index_ties: out of memory\n");
+      return 1;
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < 2 * NBLOCKS; i += 2)
+    mm_free(blocks[i]);
+  if (mm_check(2 * NBLOCKS + 2) < 0)
+    return 1;
+  for (i = 0; i < 2 * NBLOCKS; i += 2)
+    blocks[i] = mm_malloc(40);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  if (mm_check(2 * NBLOCKS + 2) < 0)
+    return 1;
+
+  secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  printf("index_ties: %d frees and mallocs in %.3f s\n", NBLOCKS, secs);
+  return secs > 1.0;
+}
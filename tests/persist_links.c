@@ -0,0 +1,91 @@
+/*
+ * persist_links.c
+ *
+ * Leaves a heap file with list links a crash could have left behind: one
+ * pointing at an allocated block, one out of the heap and one at its own
+ * block. Then picks the heap up again with mm_init, as a restart would, and
+ * checks that the heap is whole, that no allocated block is handed out
+ * again, and that nothing loops (an alarm ends the test after 10 s).
+ *
+ * Usage: persist_links
+ *   gcc -Wall -O2 -DMM_PERSIST -I. -o persist_links tests/persist_links.c mm.c memlib_os.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mm.h"
+#include "mm_ext.h"
+#include "memlib.h"
+
+#define NBLOCKS 1000
+#define SIZE    64
+#define ALL     1000000         /* more blocks than the heap holds */
+
+static char *blocks[NBLOCKS];
+
+/* Point the link at word w of free block ptr to target */
+static void set_link(char *ptr, int w, unsigned int target)
+{
+  memcpy(ptr + 4 * w, &target, sizeof(target));
+}
+
+int main(void)
+{
+  char path[] = "/tmp/persist_linksXXXXXX";
+  char *lo, *p;
+  int fd, i, j, bad = 0;
+
+  if ((fd = mkstemp(path)) < 0) {
+    perror("persist_links");
+    return 1;
+  }
+  close(fd);
+  unlink(path);
+  setenv("MM_HEAP_FILE", path, 1);
+  alarm(10);
+
+  mem_init();
+  if (mm_init(NULL) < 0) {
+    fprintf(stderr, "persist_links: mm_init failed\n");
+    return 1;
+  }
+  for (i = 0; i < NBLOCKS; i++) {
+    blocks[i] = mm_malloc(SIZE);
+    memset(blocks[i], i & 0xff, SIZE);
+  }
+  for (i = 0; i < NBLOCKS; i += 2)
+    mm_free(blocks[i]);
+
+  lo = mem_heap_lo();
+  set_link(blocks[0], 0, blocks[1] - lo);       /* at an allocated block */
+  set_link(blocks[2], 1, 0xfffffff0u);          /* out of the heap */
+  set_link(blocks[4], 0, blocks[4] - lo);       /* at itself */
+
+  /* The restart */
+  if (mm_init(NULL) < 0 || mm_check(ALL) < 0) {
+    fprintf(stderr, "persist_links: heap refused or damaged after reattach\n");
+    bad = 1;
+  }
+  for (i = 0; i < NBLOCKS && !bad; i++) {
+    if ((p = mm_malloc(SIZE)) == NULL)
+      break;
+    memset(p, 0xee, SIZE);
+  }
+  for (i = 1; i < NBLOCKS && !bad; i += 2)
+    for (j = 0; j < SIZE; j++)
+      if (blocks[i][j] != (char)(i & 0xff)) {
+        fprintf(stderr, "persist_links: allocated block %d handed out again\n", i);
+        bad = 1;
+        break;
+      }
+  if (!bad && mm_check(ALL) < 0)
+    bad = 1;
+
+  unlink(path);
+  if (!bad)
+    printf("persist_links: ok\n");
+  return bad;
+}
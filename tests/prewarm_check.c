@@ -0,0 +1,89 @@
+/*
+ * prewarm_check.c
+ *
+ * Prewarms a fresh heap from a size profile and runs mm_check over all of
+ * it, once right after mm_prewarm and once after the blocks have been
+ * allocated and freed again. Prewarmed blocks must not lie next to each
+ * other free. Once all of them are freed, the fences between them must be
+ * gone too, so a block larger than any in the profile fits without the
+ * heap growing. Run it with an argument to prewarm in address order.
+ *
+ * Usage: prewarm_check [addr]
+ *   gcc -Wall -O2 -I. -o prewarm_check tests/prewarm_check.c mm.c memlib_os.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mm.h"
+#include "mm_ext.h"
+#include "memlib.h"
+
+#define NBLOCKS 20000
+#define ALL     1000000         /* more blocks than the heap holds */
+#define BIG     65536           /* larger than any prewarmed block */
+
+static const char profile[] =
+  "# mm size profile\n"
+  "16 5000\n"
+  "32 20000\n"
+  "48 10000\n"
+  "208 3000\n"
+  "4096 200\n";
+
+static void *blocks[NBLOCKS];
+
+/* Check every block of the heap, mm_check carries on where it stopped */
+static int check_all(const char *when)
+{
+  if (mm_check(ALL) < 0) {
+    fprintf(stderr, "prewarm_check: mm_check failed %s\n", when);
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  FILE *f = tmpfile();
+  size_t heapsize;
+  int made, i;
+
+  mem_init();
+  if (f == NULL || mm_init(NULL) < 0) {
+    fprintf(stderr, "prewarm_check: setup failed\n");
+    return 1;
+  }
+  if (argc > 1)
+    mm_set_policy(MM_FIT_FIRST | MM_ORDER_ADDR);
+  fputs(profile, f);
+  fflush(f);
+  rewind(f);
+
+  if ((made = mm_prewarm(fileno(f))) <= 0) {
+    fprintf(stderr, "prewarm_check: mm_prewarm made %d blocks\n", made);
+    return 1;
+  }
+  if (check_all("after mm_prewarm") < 0)
+    return 1;
+
+  for (i = 0; i < NBLOCKS; i++)
+    blocks[i] = mm_malloc(i % 3 == 0 ? 8 : 24);
+  for (i = 0; i < NBLOCKS; i += 2)
+    mm_free(blocks[i]);
+  if (check_all("after malloc and free") < 0)
+    return 1;
+
+  for (i = 1; i < NBLOCKS; i += 2)
+    mm_free(blocks[i]);
+  heapsize = mem_heapsize();
+  if (mm_malloc(BIG) == NULL || mem_heapsize() != heapsize) {
+    fprintf(stderr, "prewarm_check: freed blocks did not merge across the fences\n");
+    return 1;
+  }
+  if (check_all("after freeing all") < 0)
+    return 1;
+
+  printf("prewarm_check: %d blocks\n", made);
+  return 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * sample_rate.c
+ *
+ * Allocates about 500 sample intervals' worth of bytes with the heap
+ * profiler on and reads the number of samples back from mm_heap_profile.
+ * The mean distance between samples must be within 15% of the rate set,
+ * which it is not when the sample intervals are drawn wrong.
+ *
+ * Usage: sample_rate
+ *   gcc -Wall -O2 -I. -o sample_rate tests/sample_rate.c mm.c memlib_os.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mm.h"
+#include "mm_ext.h"
+#include "memlib.h"
+
+#define RATE     8192
+#define SAMPLES  500           /* expected, the table keeps up to 768 */
+#define SIZE     100
+
+int main(void)
+{
+  FILE *f = tmpfile();
+  size_t total = 0;
+  double mean;
+  int count;
+
+  mem_init();
+  if (f == NULL || mm_init(NULL) < 0) {
+    fprintf(stderr, "sample_rate: setup failed\n");
+    return 1;
+  }
+  mm_set_sample_rate(RATE);
+  for (; total < (size_t)SAMPLES * RATE; total += SIZE)
+    if (mm_malloc(SIZE) == NULL) {
+      fprintf(stderr, "sample_rate: out of memory\n");
+      return 1;
+    }
+
+  if (mm_heap_profile(fileno(f)) < 0 || fseek(f, 0, SEEK_SET) != 0 ||
+      fscanf(f, "heap profile: %d:", &count) != 1 || count <= 0) {
+    fprintf(stderr, "sample_rate: no profile\n");
+    return 1;
+  }
+  mean = (double)total / count;
+  printf("sample_rate: %d samples, mean interval %.0f bytes for rate %d\n", count, mean, RATE);
+  return mean < 0.85 * RATE || mean > 1.15 * RATE;
+}
@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""
+autotune.py
+
+Tunes the build parameters of mm.c to a set of allocation traces and writes
+them out as a configuration header. Every configuration tried is compiled
+into tools/replay.c, which replays the traces and reports throughput and
+peak heap size. A configuration scores
+
+    w * (default peak / peak) + (1 - w) * (throughput / default throughput)
+
+averaged over the traces, so the defaults score 1. Each build is replayed
+several times (-r) and scored on the median of each trace, so one lucky run
+does not count. The search changes one parameter at a time, keeps a change
+only if it beats the best score so far by a margin (-m) and goes round
+again until nothing improves.
+
+The allocator is then built against the header:
+
+    gcc -O2 -DMM_TUNED_CONFIG='"mm_tuned.h"' ... mm.c memlib_os.c ...
+
+Usage: autotune.py [-w weight] [-o header] [-n runs] [-r repeats] [-m margin]
+                   [-I dir] [-D flag] trace...
+"""
+
+import argparse
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# Parameter, default, candidates. The defaults are those of mm.c.
+SPACE = [
+    ("NBINS", 25, [12, 16, 20, 25, 32, 40, 48, 64]),
+    ("BIN_STEP_BITS", 0, [0, 1, 2]),
+    ("CHUNKSIZE", 1 << 12, [1 << 10, 1 << 11, 1 << 12, 1 << 13, 1 << 14, 1 << 16]),
+    ("INITCHUNKSIZE", 1 << 6, [1 << 6, 1 << 9, 1 << 12, 1 << 14]),
+    ("SPLIT_THRESHOLD", 100, [32, 64, 100, 160, 256, 512, 1024]),
+]
+
+
+def write_header(path, config, comment):
+    with open(path, "w") as f:
+        f.write("/*\n")
+        for line in comment:
+            f.write(" * %s\n" % line)
+        f.write(" */\n")
+        for name, _, _ in SPACE:
+            f.write("#define %-16s %d\n" % (name, config[name]))
+
+
+class Tuner:
+    def __init__(self, args):
+        self.args = args
+        self.tmp = tempfile.mkdtemp(prefix="autotune")
+        self.results = {}
+        self.base = None
+
+    def measure(self, config):
+        """Build and run replay for config, {trace: (ops/s, peak)} or None.
+        Each is the median of the repeated replays."""
+        key = tuple(config[name] for name, _, _ in SPACE)
+        if key in self.results:
+            return self.results[key]
+
+        header = os.path.join(self.tmp, "tuned.h")
+        binary = os.path.join(self.tmp, "replay")
+        write_header(header, config, ["candidate"])
+        cmd = ["gcc", "-O2", '-DMM_TUNED_CONFIG="%s"' % header]
+        cmd += ["-D" + d for d in self.args.define]
+        cmd += ["-I" + d for d in self.args.include + [REPO]]
+        cmd += ["-o", binary, os.path.join(REPO, "tools", "replay.c"),
+                os.path.join(REPO, "mm.c"), os.path.join(REPO, "memlib_os.c"),
+                "-lpthread"]
+        subprocess.run(cmd, check=True)
+
+        runs = {}
+        for _ in range(self.args.repeats):
+            out = subprocess.run([binary, "-n", str(self.args.runs)] + self.args.traces,
+                                 stdout=subprocess.PIPE, universal_newlines=True)
+            if out.returncode != 0:
+                self.results[key] = None
+                return None
+            for line in out.stdout.splitlines():
+                trace, ops, secs, peak = line.split()
+                runs.setdefault(trace, []).append(
+                    (int(ops) / max(float(secs), 1e-9), int(peak)))
+        result = {trace: (statistics.median(t for t, _ in r), statistics.median(p for _, p in r))
+                  for trace, r in runs.items()}
+        self.results[key] = result
+        return result
+
+    def score(self, config):
+        result = self.measure(config)
+        if result is None:
+            return None
+        w = self.args.weight
+        total = 0.0
+        for trace, (thru, peak) in result.items():
+            base_thru, base_peak = self.base[trace]
+            total += w * base_peak / peak + (1 - w) * thru / base_thru
+        return total / len(result)
+
+    def run(self):
+        config = {name: default for name, default, _ in SPACE}
+        self.base = self.measure(config)
+        if self.base is None:
+            sys.exit("autotune: the default build fails the traces")
+        best = self.score(config)
+        log("defaults", config, best)
+
+        improved = True
+        while improved:
+            improved = False
+            for name, _, values in SPACE:
+                for value in values:
+                    if value == config[name]:
+                        continue
+                    trial = dict(config, **{name: value})
+                    s = self.score(trial)
+                    if s is not None and s > best * (1 + self.args.margin):
+                        config, best = trial, s
+                        improved = True
+                        log("better", config, best)
+        return config, best
+
+
+def log(what, config, score):
+    print("%-8s %.4f  %s" % (what, score,
+                             " ".join("%s=%d" % (n, config[n]) for n, _, _ in SPACE)),
+          file=sys.stderr)
+
+
+def main():
+    p = argparse.ArgumentParser(description="Tune mm.c to allocation traces.")
+    p.add_argument("-w", "--weight", type=float, default=0.5,
+                   help="weight of peak heap against throughput, 0 to 1")
+    p.add_argument("-o", "--output", default="mm_tuned.h")
+    p.add_argument("-n", "--runs", type=int, default=5,
+                   help="runs of each trace, the fastest counts")
+    p.add_argument("-r", "--repeats", type=int, default=3,
+                   help="replays of each build, the median counts")
+    p.add_argument("-m", "--margin", type=float, default=0.01,
+                   help="least relative gain over the best score to keep a change")
+    p.add_argument("-I", dest="include", action="append", default=[],
+                   help="directory with the lab's mm.h and memlib.h")
+    p.add_argument("-D", dest="define", action="append", default=[],
+                   help="build flag of the allocator being tuned, e.g. MM_SBRK_ZEROES")
+    p.add_argument("traces", nargs="+")
+    args = p.parse_args()
+    if not 0 <= args.weight <= 1:
+        p.error("weight must be between 0 and 1")
+    if args.repeats < 1 or args.margin < 0:
+        p.error("repeats must be at least 1 and margin not negative")
+
+    tuner = Tuner(args)
+    try:
+        config, best = tuner.run()
+    finally:
+        shutil.rmtree(tuner.tmp)
+
+    write_header(args.output, config, [
+        "Generated by tools/autotune.py, do not edit.",
+        "Traces: " + " ".join(os.path.basename(t) for t in args.traces),
+        "Score %.4f against the defaults, peak heap weighted %.2f." % (best, args.weight),
+    ])
+    print("wrote %s" % args.output, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,185 @@
+/*
+ * heapmap.c
+ *
+ * Offline viewer for the snapshots written by mm_heap_dump().
+ * Prints a fragmentation map of the heap, one character per cell of
+ * heap bytes, and a histogram of the free blocks in each segregated list.
+ *
+ *   '#' cell is fully allocated     '.' cell is fully free
+ *   '+' cell is partly allocated    ' ' beyond the last block
+ *
+ * Usage: heapmap [-w width] [-r rows] dumpfile
+ *   gcc -Wall -O2 -o heapmap tools/heapmap.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DUMP_MAGIC    0x44484d4d    /* "MMHD" */
+#define DUMP_VERSION  2
+#define MAX_BINS      64
+
+typedef struct {
+  unsigned int offset;   /* payload offset from the heap start */
+  unsigned int size;
+  unsigned int flags;    /* bit 0 alloc, bits 8-15 bin of free blocks */
+} block_t;
+
+static FILE *in;
+
+static unsigned int read_word(void)
+{
+  unsigned int w;
+
+  if (fread(&w, sizeof(w), 1, in) != 1) {
+    fprintf(stderr, "heapmap: truncated dump\n");
+    exit(1);
+  }
+  return w;
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: heapmap [-w width] [-r rows] dumpfile\n");
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int heapsize, nblocks, nbins, i, j, bin, len;
+  unsigned int bin_count[MAX_BINS], bin_listed[MAX_BINS], bin_min[MAX_BINS], min;
+  unsigned long bin_bytes[MAX_BINS], bin_max;
+  unsigned long free_bytes = 0, alloc_bytes = 0, largest = 0;
+  unsigned long cell, lo, hi, a, f;
+  int width = 64, rows = 32, c, bad = 0;
+  char range[48];
+  block_t *blocks;
+
+  while ((c = getopt(argc, argv, "w:r:")) != -1) {
+    switch (c) {
+      case 'w': width = atoi(optarg); break;
+      case 'r': rows = atoi(optarg); break;
+      default: usage();
+    }
+  }
+  if (optind != argc - 1 || width <= 0 || rows <= 0)
+    usage();
+
+  if ((in = fopen(argv[optind], "rb")) == NULL) {
+    perror(argv[optind]);
+    return 1;
+  }
+
+  if (read_word() != DUMP_MAGIC || read_word() != DUMP_VERSION) {
+    fprintf(stderr, "heapmap: %s is not a heap dump\n", argv[optind]);
+    return 1;
+  }
+  heapsize = read_word();
+  nblocks = read_word();
+  nbins = read_word();
+  if (nbins > MAX_BINS) {
+    fprintf(stderr, "heapmap: too many bins (%u)\n", nbins);
+    return 1;
+  }
+
+  blocks = malloc((nblocks + 1) * sizeof(block_t));
+  memset(bin_count, 0, sizeof(bin_count));
+  memset(bin_listed, 0, sizeof(bin_listed));
+  memset(bin_min, 0, sizeof(bin_min));
+  memset(bin_bytes, 0, sizeof(bin_bytes));
+
+  for (i = 0; i < nblocks; i++) {
+    blocks[i].offset = read_word();
+    blocks[i].size = read_word();
+    blocks[i].flags = read_word();
+    if (blocks[i].flags & 1) {
+      alloc_bytes += blocks[i].size;
+    } else {
+      bin = (blocks[i].flags >> 8) & 0xff;
+      free_bytes += blocks[i].size;
+      if (blocks[i].size > largest)
+        largest = blocks[i].size;
+      if (bin < nbins) {
+        bin_count[bin]++;
+        bin_bytes[bin] += blocks[i].size;
+      }
+    }
+  }
+
+  /* The lists should hold exactly the free blocks of their size class */
+  for (i = 0; i < nbins; i++) {
+    bin = read_word();
+    min = read_word();
+    len = read_word();
+    for (j = 0; j < len; j++)
+      read_word();
+    if (bin < nbins) {
+      bin_listed[bin] = len;
+      bin_min[bin] = min;
+    }
+  }
+
+  printf("heap %u bytes, %u blocks: %lu allocated, %lu free, largest free %lu\n",
+         heapsize, nblocks, alloc_bytes, free_bytes, largest);
+  if (free_bytes > 0)
+    printf("external fragmentation %.1f%%\n", 100.0 * (1.0 - (double)largest / free_bytes));
+
+  /* Fragmentation map */
+  cell = (heapsize + (unsigned long)width * rows - 1) / ((unsigned long)width * rows);
+  if (cell < 8)
+    cell = 8;
+  printf("\nmap, %lu bytes per cell\n", cell);
+  for (i = 0, lo = 0; lo < heapsize; lo += cell) {
+    hi = lo + cell;
+    a = f = 0;
+    /* blocks are in address order, advance to the first one overlapping the cell */
+    while (i < nblocks && blocks[i].offset - 4 + blocks[i].size <= lo)
+      i++;
+    for (j = i; j < nblocks && blocks[j].offset - 4 < hi; j++) {
+      unsigned long s = blocks[j].offset - 4, e = s + blocks[j].size;
+      unsigned long n = (e < hi ? e : hi) - (s > lo ? s : lo);
+      if (blocks[j].flags & 1)
+        a += n;
+      else
+        f += n;
+    }
+    putchar(a + f == 0 ? ' ' : f == 0 ? '#' : a == 0 ? '.' : '+');
+    if ((lo / cell) % width == (unsigned long)width - 1)
+      putchar('\n');
+  }
+  putchar('\n');
+
+  /* Per-bin histogram */
+  bin_max = 1;
+  for (i = 0; i < nbins; i++)
+    if (bin_bytes[i] > bin_max)
+      bin_max = bin_bytes[i];
+  printf("\nbin  sizes           blocks       bytes\n");
+  for (i = 0; i < nbins; i++) {
+    if (bin_count[i] == 0 && bin_listed[i] == 0)
+      continue;
+    /* list i holds sizes up to the smallest of the next list that is used */
+    for (j = i + 1; j < nbins && bin_min[j] == 0; j++)
+      ;
+    if (j == nbins)
+      snprintf(range, sizeof(range), "%u+", bin_min[i]);
+    else
+      snprintf(range, sizeof(range), "%u-%u", bin_min[i], bin_min[j] - 1);
+    printf("%3u  %-13s %8u %11lu  ", i, range, bin_count[i], bin_bytes[i]);
+    for (j = 0; j < 40 * bin_bytes[i] / bin_max; j++)
+      putchar('*');
+    if (bin_listed[i] != bin_count[i]) {
+      printf("  (list holds %u)", bin_listed[i]);
+      bad = 1;
+    }
+    putchar('\n');
+  }
+  if (bad)
+    printf("\nwarning: some lists disagree with the free blocks in the heap\n");
+
+  free(blocks);
+  fclose(in);
+  return 0;
+}
@@ -0,0 +1,176 @@
+/*
+ * replay.c
+ *
+ * Replays allocation traces in the malloc lab format against mm.c and
+ * reports the throughput and the peak heap size of each trace. Built by
+ * tools/autotune.py once for every configuration it tries.
+ *
+ *   <suggested heap size>
+ *   <number of ids>
+ *   <number of ops>
+ *   <weight>
+ *   a <id> <bytes>      allocate
+ *   r <id> <bytes>      reallocate
+ *   f <id>              free
+ *
+ * Each trace is replayed -n times on a fresh heap and the fastest run is
+ * reported, one line per trace: "<file> <ops> <seconds> <peak heap bytes>".
+ *
+ * Usage: replay [-n runs] tracefile...
+ *   gcc -Wall -O2 -I. -o replay tools/replay.c mm.c memlib_os.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mm.h"
+#include "memlib.h"
+
+typedef struct {
+  char type;             /* 'a', 'r' or 'f' */
+  int id;
+  size_t size;
+} op_t;
+
+typedef struct {
+  int nids;
+  int nops;
+  op_t *ops;
+} trace_t;
+
+static int read_trace(const char *path, trace_t *t)
+{
+  FILE *f;
+  int heap, weight, i;
+  char type[2];
+
+  if ((f = fopen(path, "r")) == NULL) {
+    perror(path);
+    return -1;
+  }
+  if (fscanf(f, "%d %d %d %d", &heap, &t->nids, &t->nops, &weight) != 4 ||
+      t->nids <= 0 || t->nops < 0) {
+    fprintf(stderr, "replay: %s: bad header\n", path);
+    fclose(f);
+    return -1;
+  }
+  t->ops = calloc(t->nops ? t->nops : 1, sizeof(op_t));
+  for (i = 0; i < t->nops; i++) {
+    op_t *op = &t->ops[i];
+
+    if (fscanf(f, "%1s %d", type, &op->id) != 2 ||
+        op->id < 0 || op->id >= t->nids)
+      break;
+    op->type = type[0];
+    if (op->type == 'f')
+      continue;
+    if ((op->type != 'a' && op->type != 'r') || fscanf(f, "%zu", &op->size) != 1)
+      break;
+  }
+  fclose(f);
+  if (i < t->nops) {
+    fprintf(stderr, "replay: %s: bad op %d\n", path, i);
+    free(t->ops);
+    return -1;
+  }
+  return 0;
+}
+
+static double now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * run - replay t once on an empty heap, return the time taken or -1.
+ *     The peak heap size is sampled after every op, which costs little
+ *     next to the op itself.
+ */
+static double run(trace_t *t, char **ptrs, size_t *peak)
+{
+  double start;
+  int i;
+
+  mem_reset_brk();
+  if (mm_init(NULL) < 0)
+    return -1;
+  memset(ptrs, 0, t->nids * sizeof(char *));
+  *peak = mem_heapsize();
+
+  start = now();
+  for (i = 0; i < t->nops; i++) {
+    op_t *op = &t->ops[i];
+
+    switch (op->type) {
+    case 'a':
+      ptrs[op->id] = mm_malloc(op->size);
+      break;
+    case 'r':
+      ptrs[op->id] = mm_realloc(ptrs[op->id], op->size);
+      break;
+    default:
+      mm_free(ptrs[op->id]);
+      ptrs[op->id] = NULL;
+      break;
+    }
+    if (op->type != 'f' && ptrs[op->id] == NULL && op->size > 0)
+      return -1;
+    if (mem_heapsize() > *peak)
+      *peak = mem_heapsize();
+  }
+  return now() - start;
+}
+
+int main(int argc, char **argv)
+{
+  int runs = 3, c, i, r, err = 0;
+
+  while ((c = getopt(argc, argv, "n:")) != -1) {
+    if (c == 'n' && atoi(optarg) > 0)
+      runs = atoi(optarg);
+    else {
+      fprintf(stderr, "usage: replay [-n runs] tracefile...\n");
+      return 2;
+    }
+  }
+  if (optind == argc) {
+    fprintf(stderr, "usage: replay [-n runs] tracefile...\n");
+    return 2;
+  }
+
+  mem_init();
+  for (i = optind; i < argc; i++) {
+    trace_t t;
+    char **ptrs;
+    double best = -1, secs;
+    size_t peak = 0;
+
+    if (read_trace(argv[i], &t) < 0) {
+      err = 1;
+      continue;
+    }
+    ptrs = malloc(t.nids * sizeof(char *));
+    for (r = 0; r < runs; r++) {
+      if ((secs = run(&t, ptrs, &peak)) < 0) {
+        fprintf(stderr, "replay: %s: out of memory\n", argv[i]);
+        best = -1;
+        break;
+      }
+      if (best < 0 || secs < best)
+        best = secs;
+    }
+    if (best >= 0)
+      printf("%s %d %.9f %zu\n", argv[i], t.nops, best, peak);
+    else
+      err = 1;
+    free(ptrs);
+    free(t.ops);
+  }
+  return err;
+}